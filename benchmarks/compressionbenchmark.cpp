@@ -0,0 +1,202 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "corpus.h"
+#include "dictionary.h"
+#include "history.h"
+#include "jsonhistoryreader.h"
+#include "snapshot.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// the block and sample sizes of snapshot.cpp
+static const qsizetype BLOCK_SIZE = 8 * 1024;  // bytes
+static const qsizetype SAMPLE_SIZE = 256 * 1024;
+static const qsizetype SAMPLE_ENTRY_SIZE = 4 * 1024;
+
+static const size_t ENTRY_COUNT = 200'000;
+
+///
+/// Compression ratio and throughput of dictionary trained deflate vs plain
+/// qCompress on snapshot blocks, and writing and loading a snapshot vs the
+/// legacy JSON file. Ratios and sizes are logged, times are measured.
+///
+class CompressionBenchmark : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir dir;
+    unique_ptr<History> history;
+    vector<QByteArray> blocks;  // UTF-16 text of the entries, most recent first
+    QByteArray samples;  // prefixes of the most recent entries, like snapshot.cpp
+    vector<QByteArrayView> sample_views;
+    QByteArray dictionary;
+    qsizetype text_size = 0;
+
+    QString snapshotPath() const { return dir.filePath(u"snapshot/clipboard_history"_s); }
+    QString jsonPath() const { return dir.filePath(u"clipboard_history.json"_s); }
+
+    static void codecs()
+    {
+        QTest::addColumn<bool>("trained");
+        QTest::newRow("qCompress") << false;
+        QTest::newRow("dictionary") << true;
+    }
+
+    static qint64 load(History &history, Snapshot &snapshot)
+    {
+        while (!snapshot.atEnd())
+            snapshot.read(history, 4096, {});
+        return (qint64)history.size();
+    }
+
+private slots:
+
+    void initTestCase()
+    {
+        // one to two years old, i.e. all shards are compressed
+        history = make_unique<History>(dir.filePath(u"blobs"_s));
+        history->setCompressionAge(24 * 60 * 60);
+        const auto start = QDateTime::currentSecsSinceEpoch() - 2 * 365 * 24 * 60 * 60;
+        const auto step = 365 * 24 * 60 * 60 / (qint64)ENTRY_COUNT;
+
+        Corpus corpus;
+        QJsonArray json;
+        vector<QString> texts;
+        for (size_t i = 0; i < ENTRY_COUNT; ++i)
+            texts.push_back(corpus.next(i));
+        for (size_t i = 0; i < ENTRY_COUNT; ++i)
+            history->add(texts[i], start + (qint64)i * step);
+
+        // most recent first, like the snapshot
+        samples.reserve(SAMPLE_SIZE + SAMPLE_ENTRY_SIZE);
+        vector<pair<qsizetype, qsizetype>> sample_entries;
+        blocks.emplace_back();
+        for (auto i = ENTRY_COUNT; i--;)
+        {
+            const auto bytes = QByteArrayView(reinterpret_cast<const char*>(texts[i].utf16()),
+                                              texts[i].size() * (qsizetype)sizeof(char16_t));
+            if (samples.size() < SAMPLE_SIZE)
+            {
+                sample_entries.emplace_back(samples.size(), min(bytes.size(), SAMPLE_ENTRY_SIZE));
+                samples.append(bytes.first(sample_entries.back().second));
+            }
+            if (blocks.back().size() + bytes.size() > BLOCK_SIZE)
+                blocks.emplace_back();
+            blocks.back().append(bytes);
+            text_size += bytes.size();
+            json.append(QJsonObject{{u"text"_s, texts[i]},
+                                    {u"datetime"_s, start + (qint64)i * step},
+                                    {u"id"_s, (qint64)i}});
+        }
+        for (const auto &[offset, size] : sample_entries)
+            sample_views.push_back(QByteArrayView(samples).sliced(offset, size));
+        dictionary = trainDictionary(sample_views);
+
+        QFile file(jsonPath());
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+
+        qInfo() << ENTRY_COUNT << "entries," << text_size / 1024 << "KiB text in"
+                << blocks.size() << "blocks," << dictionary.size() << "bytes dictionary";
+    }
+
+    void train()
+    {
+        QBENCHMARK { trainDictionary(sample_views); }
+    }
+
+    void compress_data() { codecs(); }
+
+    void compress()
+    {
+        QFETCH(bool, trained);
+        qsizetype size = 0;
+        QBENCHMARK
+        {
+            size = 0;
+            for (const auto &block : blocks)
+                size += trained ? dictionaryCompress(block, dictionary).size()
+                                : qCompress(block).size();
+        }
+        qInfo() << "ratio" << (double)text_size / (double)(size + (trained ? dictionary.size() : 0))
+                << "of" << text_size / 1024 << "KiB";
+    }
+
+    void decompress_data() { codecs(); }
+
+    void decompress()
+    {
+        QFETCH(bool, trained);
+        vector<QByteArray> compressed;
+        for (const auto &block : blocks)
+            compressed.push_back(trained ? dictionaryCompress(block, dictionary) : qCompress(block));
+
+        QByteArray out(BLOCK_SIZE, Qt::Uninitialized);
+        QBENCHMARK
+        {
+            for (size_t i = 0; i < blocks.size(); ++i)
+                if (trained)
+                    QVERIFY(dictionaryDecompress(compressed[i], dictionary,
+                                                 out.data(), blocks[i].size()));
+                else
+                    QCOMPARE(qUncompress(compressed[i]).size(), blocks[i].size());
+        }
+    }
+
+    void writeSnapshot()
+    {
+        qint64 size = 0;
+        const auto view = history->view();
+        QBENCHMARK
+        {
+            // unchanged shards are kept, i.e. start over
+            QDir(QFileInfo(snapshotPath()).path()).removeRecursively();
+            QVERIFY(QDir().mkpath(QFileInfo(snapshotPath()).path()));
+            size = Snapshot::write(snapshotPath(), Snapshot::previous(snapshotPath()), view, {});
+            QVERIFY(size > 0);
+        }
+        qInfo() << "snapshot" << size / 1024 << "KiB, json"
+                << QFileInfo(jsonPath()).size() / 1024 << "KiB, ratio"
+                << (double)QFileInfo(jsonPath()).size() / (double)size;
+    }
+
+    void loadSnapshot()
+    {
+        if (!QFile::exists(snapshotPath()))
+            QVERIFY(Snapshot::write(snapshotPath(), Snapshot::previous(snapshotPath()),
+                                    history->view(), {}) > 0);
+        QBENCHMARK
+        {
+            History loaded(dir.filePath(u"loaded_blobs"_s));
+            auto snapshot = Snapshot::open(snapshotPath());
+            QVERIFY(snapshot);
+            QCOMPARE(load(loaded, *snapshot), (qint64)ENTRY_COUNT);
+        }
+    }
+
+    void loadJson()
+    {
+        QBENCHMARK
+        {
+            History loaded(dir.filePath(u"loaded_blobs"_s));
+            QFile file(jsonPath());
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            JsonHistoryReader reader(&file);
+            JsonHistoryReader::Entry entry;
+            for (quint64 i = 0; reader.next(entry); ++i)
+                loaded.addOldest(entry.text, entry.datetime, (quint64)entry.id.value_or(i));
+            QCOMPARE(loaded.size(), ENTRY_COUNT);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(CompressionBenchmark)
+#include "compressionbenchmark.moc"
@@ -0,0 +1,68 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+
+
+///
+/// Generates synthetic clipboard texts, i.e. URLs, paths, shell commands and
+/// prose over a fixed vocabulary. Deterministic for a given _seed_.
+///
+class Corpus
+{
+public:
+
+    explicit Corpus(quint32 seed = 1) : random_(seed)
+    {
+        static const char *syllables[] = {"ka", "lo", "mi", "ne", "ra", "to", "vi", "su",
+                                          "de", "po", "fa", "gu", "bre", "stin", "qua", "zor"};
+        while (words_.size() < 4096)
+        {
+            QString word;
+            for (auto n = 2 + random_.bounded(3); n; --n)
+                word += QLatin1StringView(syllables[random_.bounded(16)]);
+            words_ << word;
+        }
+        words_.removeDuplicates();
+    }
+
+    /// A word of the vocabulary, each in roughly 1/size of the texts.
+    const QString &word(qsizetype index) const { return words_[index % words_.size()]; }
+
+    /// The size of the vocabulary.
+    qsizetype size() const { return words_.size(); }
+
+    /// The next text. _number_ makes it unique.
+    QString next(quint64 number)
+    {
+        using namespace Qt::StringLiterals;
+        switch (random_.bounded(4))
+        {
+        case 0:
+            return u"https://%1.example.org/%2/%3?id=%4"_s
+                .arg(any(), any(), any()).arg(number);
+        case 1:
+            return u"/home/user/%1/%2/%3_%4.cpp"_s.arg(any(), any(), any()).arg(number);
+        case 2:
+            return u"git commit -m \"%1 the %2 of %3\" # %4"_s
+                .arg(any(), any(), any()).arg(number);
+        default:
+        {
+            QString text;
+            for (auto n = 8 + random_.bounded(24); n; --n)
+                text += any() + u' ';
+            return text + QString::number(number);
+        }
+        }
+    }
+
+private:
+
+    const QString &any() { return words_[random_.bounded(words_.size())]; }
+
+    QRandomGenerator random_;
+    QStringList words_;
+
+};
@@ -0,0 +1,167 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "corpus.h"
+#include "history.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// the limit of plugin.cpp
+static const size_t CANDIDATE_LIMIT = 64 * 1024;
+static const qint64 MiB = 1024 * 1024;
+
+// allocations of the standard containers, Qt allocates using malloc
+static atomic_size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (auto *p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// resident set size in bytes, linux only
+static qint64 rss()
+{
+    QFile statm(u"/proc/self/statm"_s);
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    return statm.readAll().split(' ').value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+///
+/// Substring search over a history of a million entries, using the trigram
+/// index and verifying the candidates like Plugin::items() vs scanning all.
+/// Then the memory and scan latency with the compression age 0 vs 1 day, i.e.
+/// with most arena chunks compressed.
+///
+class HistoryBenchmark : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir dir;
+    unique_ptr<History> history;
+    Corpus corpus;
+    quint64 number = 0;
+
+
+    void queries() const
+    {
+        QTest::addColumn<QString>("query");
+        QTest::newRow("unique") << u"424242"_s;  // one entry
+        QTest::newRow("rare") << u"the %1 of"_s.arg(corpus.word(1));  // tens
+        QTest::newRow("word") << corpus.word(2);  // thousands
+        QTest::newRow("common") << u"example.org"_s;  // a quarter, i.e. scans
+    }
+
+private slots:
+
+    void initTestCase()
+    {
+        const size_t count = 1'000'000;
+        vector<QString> texts;
+        texts.reserve(count);
+        for (; number < count; ++number)
+            texts.push_back(corpus.next(number));
+
+        // the growth of the history only
+        const auto rss_before = rss();
+        const auto allocations_before = allocations.load();
+        history = make_unique<History>(dir.filePath(u"blobs"_s));
+        history->setCompressionAge(0);
+        const auto now = QDateTime::currentSecsSinceEpoch();
+        for (size_t i = 0; i < count; ++i)
+            history->add(texts[i], now - (qint64)(count - i));
+        const auto allocated = allocations.load() - allocations_before;
+        const auto grown = rss() - rss_before;
+
+        qsizetype text_size = 0;
+        for (const auto &text : texts)
+            text_size += text.size() * (qsizetype)sizeof(char16_t);
+        qInfo() << history->size() << "entries," << text_size / MiB << "MiB text, rss +"
+                << grown / MiB << "MiB, memoryUsage" << history->memoryUsage() / MiB << "MiB,"
+                << allocated << "allocations," << (double)allocated / (double)count
+                << "per entry";
+    }
+
+    void search_data() { queries(); }
+
+    void search()
+    {
+        QFETCH(QString, query);
+        size_t matches = 0;
+        QBENCHMARK
+        {
+            matches = 0;
+            auto count = [&](size_t, const ClipboardEntry &, QStringView text)
+            { matches += text.contains(query, Qt::CaseInsensitive); };
+
+            if (auto ids = history->candidates(
+                    query, min(CANDIDATE_LIMIT, history->size() / 4)); ids)
+                history->forEach(span(*ids), count);
+            else
+                history->forEach([&](const ClipboardEntry &e, QStringView t){ count(0, e, t); });
+        }
+        QVERIFY(matches > 0);
+    }
+
+    void scan_data() { queries(); }
+
+    void scan()
+    {
+        QFETCH(QString, query);
+        size_t matches = 0;
+        QBENCHMARK
+        {
+            matches = 0;
+            history->forEach([&](const ClipboardEntry &, QStringView text)
+                             { matches += text.contains(query, Qt::CaseInsensitive); });
+        }
+        QVERIFY(matches > 0);
+    }
+
+    // the incremental index update of checkClipboard and removal
+    void addRemove()
+    {
+        const auto now = QDateTime::currentSecsSinceEpoch();
+        QBENCHMARK
+        {
+            const auto id = history->add(corpus.next(number++), now);
+            history->remove(id);
+            (void)history->truncate(SIZE_MAX, SIZE_MAX);  // compacts, like the plugin
+        }
+    }
+
+    // the entries span 11.6 days, i.e. the chunks of all but the last day
+    void compress()
+    {
+        const auto before = rss();
+        history->setCompressionAge(24 * 60 * 60);
+        auto chunks = history->freezable();
+        QBENCHMARK_ONCE { TextArena::compress(chunks); }
+        history->freeze(chunks);
+        const auto count = chunks.size();
+        chunks.clear();  // the uncompressed buffers
+        qInfo() << count << "chunks compressed, rss" << before / MiB << "->"
+                << rss() / MiB << "MiB, memoryUsage" << history->memoryUsage() / MiB << "MiB";
+    }
+
+    void compressedScan_data() { queries(); }
+
+    void compressedScan() { scan(); }
+};
+
+QTEST_GUILESS_MAIN(HistoryBenchmark)
+#include "historybenchmark.moc"
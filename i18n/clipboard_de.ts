@@ -27,5 +27,65 @@
         <source>Store history</source>
         <translation>Verlauf speichern</translation>
     </message>
+    <message>
+        <source>Memory limit</source>
+        <translation>Speicherlimit</translation>
+    </message>
+    <message>
+        <source>%1 in use</source>
+        <translation>%1 belegt</translation>
+    </message>
+    <message>
+        <source>Spill to disk above</source>
+        <translation>Auf Festplatte auslagern ab</translation>
+    </message>
+    <message>
+        <source>Never</source>
+        <translation>Nie</translation>
+    </message>
+    <message>
+        <source>Unlimited</source>
+        <translation>Unbegrenzt</translation>
+    </message>
+    <message>
+        <source>Compress entries older than</source>
+        <translation>Einträge komprimieren älter als</translation>
+    </message>
+    <message>
+        <source> days</source>
+        <translation> Tage</translation>
+    </message>
+    <message>
+        <source>Loading clipboard history…</source>
+        <translation>Lade Zwischenablageverlauf…</translation>
+    </message>
+    <message>
+        <source>%1 entries loaded</source>
+        <translation>%1 Einträge geladen</translation>
+    </message>
+    <message>
+        <source>Shutdown time budget</source>
+        <translation>Zeitbudget beim Beenden</translation>
+    </message>
+    <message>
+        <source>Batched</source>
+        <translation>Gebündelt</translation>
+    </message>
+    <message>
+        <source>Immediately</source>
+        <translation>Sofort</translation>
+    </message>
+    <message>
+        <source>Sync to disk</source>
+        <translation>Auf Festplatte synchronisieren</translation>
+    </message>
+    <message>
+        <source>SQLite storage</source>
+        <translation>SQLite-Speicher</translation>
+    </message>
+    <message>
+        <source>Searches the history in an SQLite database, stored on disk only if the history is stored. Matches substrings. Takes effect on restart.</source>
+        <translation>Durchsucht den Verlauf in einer SQLite-Datenbank, die nur bei gespeichertem Verlauf auf der Festplatte liegt. Findet Teilzeichenketten. Wirksam nach einem Neustart.</translation>
+    </message>
 </context>
 </TS>
@@ -27,5 +27,65 @@
         <source>Store history</source>
         <translation></translation>
     </message>
+    <message>
+        <source>Memory limit</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>%1 in use</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Spill to disk above</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Never</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Unlimited</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Compress entries older than</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source> days</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Loading clipboard history…</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>%1 entries loaded</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Shutdown time budget</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Batched</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Immediately</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Sync to disk</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>SQLite storage</source>
+        <translation></translation>
+    </message>
+    <message>
+        <source>Searches the history in an SQLite database, stored on disk only if the history is stored. Matches substrings. Takes effect on restart.</source>
+        <translation></translation>
+    </message>
 </context>
 </TS>
@@ -0,0 +1,141 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "blobstore.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <mutex>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// removed once neither the store nor a reader uses it
+struct BlobStore::File
+{
+    mutable QFile file;
+    mutable std::mutex mutex;
+
+    ~File() { file.remove(); }
+
+    template<class F>
+    auto withMapped(Ref ref, F &&f) const
+    {
+        lock_guard lock(mutex);
+        auto *data = file.map(ref.offset, ref.length * (qint64)sizeof(char16_t));
+        auto result = f(QStringView(reinterpret_cast<const char16_t*>(data), data ? ref.length : 0));
+        if (data)
+            file.unmap(data);
+        return result;
+    }
+};
+
+QString BlobStore::Reader::read(Ref ref) const
+{
+    if (!file_)
+        return {};
+    return file_->withMapped(ref, [](QStringView text){ return text.toString(); });
+}
+
+BlobStore::BlobStore(QString path) : path_(::move(path)) {}
+
+BlobStore::~BlobStore() = default;
+
+shared_ptr<BlobStore::File> BlobStore::open()
+{
+    // a new name each, readers may still use the previous ones
+    const QFileInfo info(path_);
+    auto dir = info.dir();
+    dir.mkpath(u"."_s);
+
+    // files left by a crash
+    if (files_ == 0)
+        for (const auto &name : dir.entryList({info.fileName() + u".*"_s}, QDir::Files))
+            dir.remove(name);
+    auto file = make_shared<File>();
+    file->file.setFileName(u"%1.%2"_s.arg(path_).arg(files_++));
+    if (!file->file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        return {};
+    return file;
+}
+
+BlobStore::Ref BlobStore::append(QStringView text)
+{
+    if (!file_ && !(file_ = open()))
+        return {0, 0};
+
+    lock_guard lock(file_->mutex);
+    const auto bytes = text.size() * (qint64)sizeof(char16_t);
+    Ref ref{file_->file.size(), text.size()};
+    if (!file_->file.seek(ref.offset)
+        || file_->file.write(reinterpret_cast<const char*>(text.utf16()), bytes) != bytes
+        || !file_->file.flush())
+        return {0, 0};
+
+    live_ += bytes;
+    return ref;
+}
+
+QString BlobStore::read(Ref ref) const { return reader().read(ref); }
+
+BlobStore::Reader BlobStore::reader() const
+{
+    Reader reader;
+    reader.file_ = file_;
+    return reader;
+}
+
+bool BlobStore::equals(Ref ref, QStringView text) const
+{
+    return file_
+           && ref.length == text.size()
+           && file_->withMapped(ref, [&](QStringView blob){ return blob == text; });
+}
+
+void BlobStore::release(Ref ref)
+{
+    const auto bytes = ref.length * (qint64)sizeof(char16_t);
+    live_ -= bytes;
+    dead_ += bytes;
+}
+
+void BlobStore::retain(qint64 bytes)
+{
+    dead_ += live_ - bytes;
+    live_ = bytes;
+}
+
+void BlobStore::compact(const vector<Ref*> &refs)
+{
+    if (!file_)
+        return;
+
+    auto file = open();
+    if (!file)
+        return;
+
+    vector<qint64> offsets;
+    offsets.reserve(refs.size());
+    for (auto *ref : refs)
+    {
+        offsets.push_back(file->file.pos());
+        if (!file_->withMapped(*ref, [&](QStringView text)
+            {
+                const auto bytes = text.size() * (qint64)sizeof(char16_t);
+                return text.size() == ref->length
+                       && file->file.write(reinterpret_cast<const char*>(text.utf16()), bytes)
+                              == bytes;
+            }))
+            return;  // keep the old file, the new one is removed
+    }
+    if (!file->file.flush())
+        return;
+
+    // the old file is removed once its readers are done
+    file_ = ::move(file);
+    for (size_t i = 0; i < refs.size(); ++i)
+        refs[i]->offset = offsets[i];
+    dead_ = 0;
+}
+
+qint64 BlobStore::liveSize() const { return live_; }
+
+qint64 BlobStore::deadSize() const { return dead_; }
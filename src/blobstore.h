@@ -0,0 +1,87 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <memory>
+#include <vector>
+
+
+///
+/// Append-only file for large UTF-16 texts.
+///
+/// Blobs are read by mapping their region of the file, such that nothing but
+/// the requested text gets paged in. The file is transient, it is created on
+/// the first append and removed once it is neither used nor read. Compaction
+/// moves the blobs to a new file, readers keep reading the file they were
+/// taken from.
+///
+/// Reads are thread-safe, modifications are not.
+///
+class BlobStore
+{
+    struct File;
+
+public:
+
+    struct Ref
+    {
+        qint64 offset;  // in bytes
+        qint64 length;  // in UTF-16 code units, zero if not stored
+    };
+
+    ///
+    /// Reads the blobs of the current file, e.g. off the lock of the owner.
+    /// Unaffected by compactions, keeps the file.
+    ///
+    class Reader
+    {
+    public:
+        /// Reads the text referenced by _ref_.
+        QString read(Ref ref) const;
+
+    private:
+        friend class BlobStore;
+        std::shared_ptr<const File> file_;
+    };
+
+    explicit BlobStore(QString path);
+    ~BlobStore();
+
+    /// Writes _text_ to the file.
+    Ref append(QStringView text);
+
+    /// Reads the text referenced by _ref_.
+    QString read(Ref ref) const;
+
+    /// Returns a reader of the refs handed out so far.
+    Reader reader() const;
+
+    /// Returns true if the text referenced by _ref_ equals _text_.
+    bool equals(Ref ref, QStringView text) const;
+
+    /// Marks the text referenced by _ref_ as unused.
+    void release(Ref ref);
+
+    /// Marks all text but _bytes_ as unused. Used when dropping many blobs at once.
+    void retain(qint64 bytes);
+
+    /// Moves the blobs referenced by _refs_ to a new file and updates the refs.
+    void compact(const std::vector<Ref*> &refs);
+
+    /// The number of bytes in use.
+    qint64 liveSize() const;
+
+    /// The number of bytes released but not yet reclaimed.
+    qint64 deadSize() const;
+
+private:
+
+    std::shared_ptr<File> open();
+
+    const QString path_;
+    std::shared_ptr<File> file_;
+    quint64 files_ = 0;  // opened, names them
+    qint64 live_ = 0;
+    qint64 dead_ = 0;
+
+};
@@ -0,0 +1,128 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "clipboarditem.h"
+#include "plugin.h"
+#include <QDateTime>
+#include <QLocale>
+#include <albert/icon.h>
+#include <albert/plugin/snippets.h>
+#include <albert/systemutil.h>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+namespace {
+
+// Recently formatted dates. Scrolling renders runs of entries of the same
+// second, locale formatting is expensive.
+class DateCache
+{
+public:
+    QString format(qint64 datetime)
+    {
+        lock_guard lock(mutex_);
+        auto &slot = slots_[(size_t)datetime % slots_.size()];
+        if (slot.text.isNull() || slot.datetime != datetime)
+            slot = {datetime, QLocale().toString(QDateTime::fromSecsSinceEpoch(datetime),
+                                                 QLocale::LongFormat)};
+        return slot.text;
+    }
+
+private:
+    struct Slot
+    {
+        qint64 datetime;
+        QString text;
+    };
+
+    mutex mutex_;
+    array<Slot, 64> slots_;
+};
+
+}
+
+ClipboardItem::ClipboardItem(Plugin &plugin, int rank, quint64 id, qint64 datetime,
+                             bool spilled):
+    plugin_(plugin),
+    rank_(rank),
+    id_(id),
+    datetime_(datetime),
+    spilled_(spilled)
+{}
+
+ClipboardItem::ClipboardItem(Plugin &plugin, int rank, quint64 id, qint64 datetime,
+                             QString text):
+    ClipboardItem(plugin, rank, id, datetime, false)
+{ text_ = ::move(text); }
+
+QString ClipboardItem::id() const { return plugin_.id(); }
+
+QString ClipboardItem::text() const
+{
+    // empty if removed meanwhile
+    call_once(resolved_, [this]
+    {
+        if (text_.isNull())
+        {
+            shared_lock lock(plugin_.mutex);
+            text_ = plugin_.history.resident(id_);
+        }
+    });
+    return text_;
+}
+
+QString ClipboardItem::subtext() const
+{
+    static DateCache dates;
+    return u"#%1 %2"_s.arg(QString::number(rank_), dates.format(datetime_));
+}
+
+unique_ptr<Icon> ClipboardItem::icon() const { return Icon::grapheme(u"📋"_s); }
+
+vector<Action> ClipboardItem::actions() const
+{
+    static const auto tr_cp = Plugin::tr("Copy and paste");
+    static const auto tr_c = Plugin::tr("Copy");
+    static const auto tr_r = Plugin::tr("Remove");
+    static const auto tr_s = Plugin::tr("Save as snippet");
+
+    // spilled entries page in the full text on activation only
+    auto full_text = [&plugin=plugin_, id=id_, text=text(), spilled=spilled_]
+    {
+        if (!spilled)
+            return text;
+        shared_lock lock(plugin.mutex);
+        return plugin.history.text(id);
+    };
+
+    vector<Action> actions;
+
+    if(havePasteSupport())
+        actions.emplace_back(
+            u"c"_s, tr_cp,
+            [full_text](){ setClipboardTextAndPaste(full_text()); }
+        );
+
+    actions.emplace_back(
+        u"cp"_s, tr_c,
+        [full_text](){ setClipboardText(full_text()); }
+    );
+
+    actions.emplace_back(
+        u"r"_s, tr_r,
+        [&plugin=plugin_, id=id_](){ plugin.removeEntry(id); }
+    );
+
+    if (plugin_.snippets)
+        actions.emplace_back(
+            u"s"_s, tr_s,
+            [&plugin=plugin_, full_text]()
+            {
+                plugin.snippets->addSnippet(full_text());
+            });
+
+    return actions;
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <albert/item.h>
+#include <mutex>
+class Plugin;
+
+
+///
+/// A clipboard history entry as query result.
+///
+/// Queries create an item per match while most of them are never shown, let
+/// alone activated. Hence the item holds the plain entry data only and builds
+/// its text, subtext and actions when asked for them.
+///
+class ClipboardItem : public albert::Item
+{
+public:
+
+    /// Constructs an item for the entry with _id_ at _rank_ in the history.
+    /// The text is read from the history once shown.
+    ClipboardItem(Plugin &plugin, int rank, quint64 id, qint64 datetime, bool spilled);
+
+    /// Constructs an item for the entry with _id_ at _rank_ and the full _text_.
+    ClipboardItem(Plugin &plugin, int rank, quint64 id, qint64 datetime, QString text);
+
+    QString id() const override;
+    QString text() const override;
+    QString subtext() const override;
+    std::unique_ptr<albert::Icon> icon() const override;
+    std::vector<albert::Action> actions() const override;
+
+private:
+
+    Plugin &plugin_;
+    int rank_;
+    quint64 id_;
+    qint64 datetime_;
+    bool spilled_;
+    mutable std::once_flag resolved_;
+    mutable QString text_;  // the full text unless spilled, then a preview
+
+};
@@ -0,0 +1,103 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "crc32c.h"
+#include <array>
+#include <cstring>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_X86
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM
+#endif
+using namespace std;
+
+namespace {
+
+constexpr quint32 polynomial = 0x82f63b78;  // reflected
+
+// slicing by 8
+constexpr auto tables = []
+{
+    array<array<quint32, 256>, 8> t{};
+    for (quint32 i = 0; i < 256; ++i)
+    {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k)
+            c = c & 1 ? (c >> 1) ^ polynomial : c >> 1;
+        t[0][i] = c;
+    }
+    for (quint32 i = 0; i < 256; ++i)
+        for (size_t s = 1; s < 8; ++s)
+            t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+    return t;
+}();
+
+quint32 software(const uchar *p, size_t size, quint32 c)
+{
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        quint64 v;
+        memcpy(&v, p, 8);
+        v ^= c;  // little endian
+        c = tables[7][v & 0xff] ^ tables[6][(v >> 8) & 0xff]
+            ^ tables[5][(v >> 16) & 0xff] ^ tables[4][(v >> 24) & 0xff]
+            ^ tables[3][(v >> 32) & 0xff] ^ tables[2][(v >> 40) & 0xff]
+            ^ tables[1][(v >> 48) & 0xff] ^ tables[0][v >> 56];
+    }
+    for (; size; ++p, --size)
+        c = tables[0][(c ^ *p) & 0xff] ^ (c >> 8);
+    return c;
+}
+
+#if defined(CRC32C_X86)
+
+__attribute__((target("sse4.2")))
+quint32 hardware(const uchar *p, size_t size, quint32 c)
+{
+    quint64 c64 = c;
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        quint64 v;
+        memcpy(&v, p, 8);
+        c64 = _mm_crc32_u64(c64, v);
+    }
+    c = (quint32)c64;
+    for (; size; ++p, --size)
+        c = _mm_crc32_u8(c, *p);
+    return c;
+}
+
+const bool have_hardware = __builtin_cpu_supports("sse4.2");
+
+#elif defined(CRC32C_ARM)
+
+quint32 hardware(const uchar *p, size_t size, quint32 c)
+{
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        quint64 v;
+        memcpy(&v, p, 8);
+        c = __crc32cd(c, v);
+    }
+    for (; size; ++p, --size)
+        c = __crc32cb(c, *p);
+    return c;
+}
+
+const bool have_hardware = true;
+
+#endif
+
+}
+
+quint32 crc32c(const void *data, size_t size, quint32 crc)
+{
+    const auto *p = static_cast<const uchar*>(data);
+    crc = ~crc;
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+    if (have_hardware)
+        return ~hardware(p, size, crc);
+#endif
+    return ~software(p, size, crc);
+}
@@ -0,0 +1,9 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QtGlobal>
+#include <cstddef>
+
+/// Returns the CRC-32C (Castagnoli) of _size_ bytes at _data_, continuing _crc_.
+/// Uses the CPU instructions if available.
+quint32 crc32c(const void *data, size_t size, quint32 crc = 0);
@@ -0,0 +1,104 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "dictionary.h"
+#include <QHash>
+#include <algorithm>
+#include <unordered_map>
+#include <zlib.h>
+using namespace std;
+
+static constexpr qsizetype gram = 16;  // bytes, i.e. 8 UTF-16 code units
+static constexpr qsizetype segment = 64;
+
+QByteArray trainDictionary(const vector<QByteArrayView> &samples, qsizetype capacity)
+{
+    // frequency of the grams across all samples
+    unordered_map<size_t, quint32> frequency;
+    for (const auto sample : samples)
+        for (qsizetype i = 0; i + gram <= sample.size(); i += 2)
+            ++frequency[qHash(sample.sliced(i, gram))];
+
+    auto score = [&](QByteArrayView s)
+    {
+        quint64 score = 0;
+        for (qsizetype i = 0; i + gram <= s.size(); i += 2)
+            if (auto it = frequency.find(qHash(s.sliced(i, gram)));
+                it != frequency.end() && it->second > 1)
+                score += it->second;
+        return score;
+    };
+
+    struct Candidate { quint64 score; QByteArrayView segment; };
+    vector<Candidate> candidates;
+    for (const auto sample : samples)
+        for (qsizetype i = 0; i + segment <= sample.size(); i += segment / 2)
+            if (const auto s = sample.sliced(i, segment); const auto c = score(s))
+                candidates.push_back({c, s});
+
+    ranges::sort(candidates, greater{}, &Candidate::score);
+
+    // greedy, grams covered by picked segments do not count again
+    vector<QByteArrayView> picked;
+    for (const auto &candidate : candidates)
+    {
+        if ((qsizetype)picked.size() * segment + segment > capacity)
+            break;
+
+        if (score(candidate.segment) * 2 < candidate.score)
+            continue;
+
+        picked.push_back(candidate.segment);
+        for (qsizetype i = 0; i + gram <= segment; i += 2)
+            frequency[qHash(candidate.segment.sliced(i, gram))] = 0;
+    }
+
+    QByteArray dictionary;
+    dictionary.reserve((qsizetype)picked.size() * segment);
+    for (auto it = picked.rbegin(); it != picked.rend(); ++it)
+        dictionary.append(*it);
+    return dictionary;
+}
+
+QByteArray dictionaryCompress(QByteArrayView data, QByteArrayView dictionary)
+{
+    z_stream z{};
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return {};
+
+    if (!dictionary.isEmpty())
+        deflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary.data()),
+                             (uInt)dictionary.size());
+
+    QByteArray out((qsizetype)deflateBound(&z, (uLong)data.size()), Qt::Uninitialized);
+    z.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.data()));
+    z.avail_in = (uInt)data.size();
+    z.next_out = reinterpret_cast<Bytef*>(out.data());
+    z.avail_out = (uInt)out.size();
+
+    const auto ret = deflate(&z, Z_FINISH);
+    out.resize(out.size() - (qsizetype)z.avail_out);
+    deflateEnd(&z);
+    return ret == Z_STREAM_END ? out : QByteArray();
+}
+
+bool dictionaryDecompress(QByteArrayView data, QByteArrayView dictionary, char *out, qsizetype size)
+{
+    z_stream z{};
+    if (inflateInit2(&z, -MAX_WBITS) != Z_OK)
+        return false;
+
+    // raw streams take the dictionary up front
+    if (!dictionary.isEmpty())
+        inflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary.data()),
+                             (uInt)dictionary.size());
+
+    z.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.data()));
+    z.avail_in = (uInt)data.size();
+    z.next_out = reinterpret_cast<Bytef*>(out);
+    z.avail_out = (uInt)size;
+
+    const auto ret = inflate(&z, Z_FINISH);
+    const bool ok = ret == Z_STREAM_END && z.avail_out == 0;
+    inflateEnd(&z);
+    return ok;
+}
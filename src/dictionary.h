@@ -0,0 +1,19 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <vector>
+
+/// Trains a zlib preset dictionary of at most _capacity_ bytes from _samples_.
+/// Picks the segments covering the most frequent substrings, the most
+/// valuable last, where they are cheapest to reference. Keeps UTF-16 alignment.
+QByteArray trainDictionary(const std::vector<QByteArrayView> &samples, qsizetype capacity = 32 * 1024);
+
+/// Compresses _data_ to a raw deflate stream using the preset _dictionary_.
+/// Returns a null array on failure.
+QByteArray dictionaryCompress(QByteArrayView data, QByteArrayView dictionary);
+
+/// Decompresses _data_ compressed with _dictionary_ into _size_ bytes at _out_.
+/// Returns false on failure.
+bool dictionaryDecompress(QByteArrayView data, QByteArrayView dictionary, char *out, qsizetype size);
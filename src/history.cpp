@@ -0,0 +1,498 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "history.h"
+#include <QDateTime>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+using namespace std;
+
+static constexpr auto npos = numeric_limits<qint64>::min();
+
+// order independent, an entry changes its timestamp when it moves
+static quint64 digest(const ClipboardEntry &entry) { return qHashMulti(0, entry.id, entry.datetime); }
+
+// resident text of spilled entries, enough to match and display
+static constexpr qsizetype preview_length = 1024;
+
+// deque slot plus a hash and an id index node (next pointer, cached hash, key, value)
+static constexpr size_t entry_overhead =
+    sizeof(ClipboardEntry) + 2 * (sizeof(void*) + 2 * sizeof(size_t) + sizeof(qint64));
+
+History::History(QString blob_file) : blobs_(::move(blob_file)) {}
+
+size_t History::hash(QStringView text) { return qHash(text, 0); }
+
+qint64 History::month(qint64 datetime)
+{
+    using namespace chrono;
+    const year_month_day date{floor<days>(sys_seconds{seconds{datetime}})};
+    return (int)date.year() * 12 + (unsigned)date.month() - 1;
+}
+
+size_t History::size() const { return entries_.size() - tombstones_.size(); }
+
+quint64 History::generation() const { return generation_; }
+
+quint64 History::nextId() const { return next_id_; }
+
+void History::reserveIds(quint64 id) { next_id_ = max(next_id_, id); }
+
+size_t History::memoryUsage() const
+{
+    return size() * entry_overhead + arena_.liveSize() * sizeof(char16_t)
+           + trigrams_.memoryUsage();
+}
+
+void History::setSpillThreshold(qint64 bytes) { spill_threshold_ = bytes; }
+
+qint64 History::compressionAge() const { return compression_age_; }
+
+void History::setCompressionAge(qint64 seconds)
+{
+    compression_age_ = seconds;
+}
+
+quint64 History::add(QStringView text, qint64 datetime) { return add(text, datetime, next_id_); }
+
+quint64 History::add(QStringView text, qint64 datetime, quint64 id)
+{
+    const auto hash = History::hash(text);
+    const auto back_seq = front_seq_ + (qint64)entries_.size() - 1;
+    ++generation_;
+
+    if (auto seq = find(text, hash); seq == npos)
+    {
+        entries_.push_back(makeEntry(text, datetime, hash, id));
+        index_.emplace(hash, back_seq + 1);
+        positions_.emplace(id, back_seq + 1);
+        addToMonth(entries_.back());
+        indexText(entries_.back(), text);
+    }
+    else if (seq != back_seq)
+    {
+        // move to the back, the resident text is appended again to keep the
+        // arena chunks in chronological order, the blob stays where it is
+        auto &entry = at(seq);
+        const auto resident = entry.spilled() ? text.left(preview_length) : text;
+        entries_.push_back({arena_.append(resident, datetime), entry.blob, entry.id, datetime, hash});
+        removeFromMonth(entry);
+        addToMonth(entries_.back());
+        arena_.release(entry.text);
+        entry.text.length = 0;
+        tombstones_.insert(seq);
+        unindex(hash, seq);
+        index_.emplace(hash, back_seq + 1);
+        positions_[entry.id] = back_seq + 1;
+    }
+    else
+    {
+        removeFromMonth(at(seq));
+        at(seq).datetime = datetime;
+        addToMonth(at(seq));
+    }
+
+    return entries_.back().id;
+}
+
+void History::addOldest(QStringView text, qint64 datetime, quint64 id, bool indexed)
+{
+    if (const auto hash = History::hash(text);
+        !text.isEmpty() && find(text, hash) == npos)
+    {
+        entries_.push_front(makeEntry(text, datetime, hash, id));
+        index_.emplace(hash, --front_seq_);
+        positions_.emplace(id, front_seq_);
+        addToMonth(entries_.front());
+        ++generation_;
+        if (!indexed)
+            indexText(entries_.front(), text);
+    }
+}
+
+quint32 History::addExternalText(QStringView text, shared_ptr<const void> owner)
+{ return arena_.addExternal(text, ::move(owner)); }
+
+quint32 History::addCompressedText(QByteArray compressed, quint32 size,
+                                   shared_ptr<const QByteArray> dictionary)
+{ return arena_.addCompressed(::move(compressed), size, ::move(dictionary)); }
+
+void History::addOldest(quint32 chunk, quint32 offset, quint32 length,
+                        qint64 datetime, quint64 id, size_t hash, TextArena::Cache &cache,
+                        bool indexed)
+{
+    // view lazily, compressed chunks stay compressed
+    auto text = [&]{ return arena_.view({chunk, offset, length}, cache); };
+
+    if (spill_threshold_ > 0 && length * (qint64)sizeof(char16_t) > spill_threshold_)
+        addOldest(text(), datetime, id, indexed);  // spill a copy
+
+    else if (length && (!index_.contains(hash) || find(text(), hash) == npos))
+    {
+        next_id_ = max(next_id_, id + 1);
+        entries_.push_front({arena_.reference(chunk, offset, length, datetime), {0, 0},
+                             id, datetime, hash});
+        index_.emplace(hash, --front_seq_);
+        positions_.emplace(id, front_seq_);
+        addToMonth(entries_.front());
+        ++generation_;
+        if (!indexed)
+            indexText(entries_.front(), text());
+    }
+}
+
+bool History::contains(quint64 id) const { return positions_.contains(id); }
+
+bool History::remove(quint64 id)
+{
+    if (auto it = positions_.find(id); it != positions_.end())
+    {
+        release(it->second);
+        ++generation_;
+        return true;
+    }
+    return false;
+}
+
+unique_ptr<History::Detached> History::truncate(size_t limit, size_t bytes)
+{
+    // dropping most of the history, rebuild the entries and indexes from the
+    // survivors instead, sharing their arena chunks, and detach the rest, such
+    // that it can be freed off the lock
+    if (limit < size() / 2 || bytes < memoryUsage() / 2)
+    {
+        size_t count = 0, usage = 0;
+        auto it = entries_.rbegin();
+        for (; it != entries_.rend(); ++it)
+            if (!it->removed())
+            {
+                const auto entry_usage = entry_overhead + it->text.length * sizeof(char16_t)
+                                         + TrigramIndex::memoryUsage(it->text.length);
+                if (count == limit || bytes < usage + entry_usage)
+                    break;
+                ++count;
+                usage += entry_usage;
+            }
+        return compact(entries_.rend() - it);
+    }
+
+    while (!entries_.empty()
+           && (limit < size() || bytes < memoryUsage() || entries_.front().removed()))
+    {
+        // released entries are tombstones until popped
+        if (!entries_.front().removed())
+            release(front_seq_);
+        tombstones_.erase(front_seq_);
+
+        entries_.pop_front();
+        ++front_seq_;
+        ++generation_;
+    }
+
+    if (needsCompaction())
+        return compact();
+
+    return nullptr;
+}
+
+QString History::text(const ClipboardEntry &entry) const
+{
+    if (entry.spilled())
+        return blobs_.read(entry.blob);
+    else
+    {
+        TextArena::Cache cache;
+        return arena_.view(entry.text, cache).toString();
+    }
+}
+
+QString History::text(quint64 id) const
+{
+    if (auto it = positions_.find(id); it != positions_.end())
+        return text(at(it->second));
+    return {};
+}
+
+QString History::resident(quint64 id) const
+{
+    TextArena::Cache cache;
+    if (auto it = positions_.find(id); it != positions_.end())
+        return arena_.view(at(it->second).text, cache).toString();
+    return {};
+}
+
+vector<History::Month> History::months() const
+{
+    vector<Month> months;
+    months.reserve(months_.size());
+    for (const auto &[m, month] : months_)
+        months.push_back(month);
+    return months;
+}
+
+History::View History::view() const
+{
+    // partitioned in one pass, entries are mostly in chronological order
+    auto view = this->view(span<const qint64>());
+    auto current = npos;
+    vector<ClipboardEntry> *entries = nullptr;
+    for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+        if (!it->removed())
+        {
+            if (const auto m = History::month(it->datetime); m != current)
+            {
+                current = m;
+                entries = &view.entries_[m];
+            }
+            entries->push_back(*it);
+        }
+    return view;
+}
+
+History::View History::view(span<const qint64> months) const
+{
+    View view;
+    view.months_ = this->months();
+    for (const auto m : months)
+        if (auto it = months_.find(m); it != months_.end())
+            copyMonth(m, it->second.count, view.entries_[m]);
+    view.arena_ = arena_;
+    view.blobs_ = blobs_.reader();
+    view.next_id_ = next_id_;
+    view.compression_age_ = compression_age_;
+    return view;
+}
+
+QString History::View::text(const ClipboardEntry &entry) const
+{
+    if (entry.spilled())
+        return blobs_.read(entry.blob);
+    else
+    {
+        TextArena::Cache cache;
+        return arena_.view(entry.text, cache).toString();
+    }
+}
+
+ClipboardEntry History::makeEntry(QStringView text, qint64 datetime, size_t hash, quint64 id)
+{
+    next_id_ = max(next_id_, id + 1);
+
+    if (spill_threshold_ > 0 && text.size() * (qint64)sizeof(char16_t) > spill_threshold_)
+        if (auto blob = blobs_.append(text); blob.length)
+            return {arena_.append(text.left(preview_length), datetime), blob, id, datetime, hash};
+
+    return {arena_.append(text, datetime), {0, 0}, id, datetime, hash};
+}
+
+qint64 History::find(QStringView text, size_t hash) const
+{
+    // full compare only on hash match
+    TextArena::Cache cache;
+    for (auto [b, e] = index_.equal_range(hash); b != e; ++b)
+        if (const auto &entry = at(b->second);
+            entry.spilled() ? blobs_.equals(entry.blob, text)
+                            : arena_.view(entry.text, cache) == text)
+            return b->second;
+    return npos;
+}
+
+optional<vector<quint64>> History::candidates(QStringView query, size_t limit) const
+{
+    const auto postings = trigrams_.find(query);
+    if (!postings || postings->size() > limit)
+        return nullopt;
+
+    // live ones, most recent first
+    vector<qint64> seqs;
+    for (const auto id : *postings)
+        if (auto it = positions_.find(id); it != positions_.end())
+            seqs.push_back(it->second);
+    ranges::sort(seqs, greater<>());
+    seqs.erase(ranges::unique(seqs).begin(), seqs.end());
+
+    vector<quint64> ids;
+    ids.reserve(seqs.size());
+    for (const auto seq : seqs)
+        ids.push_back(at(seq).id);
+    return ids;
+}
+
+void History::addIndex(quint64 key, span<const quint64> ids) { trigrams_.addPostings(key, ids); }
+
+void History::discardIndex(quint64 count) { trigrams_.discard(count); }
+
+quint64 History::indexGeneration() const { return index_generation_; }
+
+void History::indexText(const ClipboardEntry &entry, QStringView text)
+{ trigrams_.add(entry.id, entry.spilled() ? text.left(preview_length) : text); }
+
+size_t History::rank(qint64 seq) const
+{
+    const auto back_seq = front_seq_ + (qint64)entries_.size() - 1;
+    return (size_t)(back_seq - seq + 1) - tombstones_.countAbove(seq);
+}
+
+ClipboardEntry &History::at(qint64 seq) { return entries_[seq - front_seq_]; }
+
+const ClipboardEntry &History::at(qint64 seq) const { return entries_[seq - front_seq_]; }
+
+void History::seek(Cursor &cursor) const
+{
+    if (cursor.compactions != compactions_)
+    {
+        // resume after the last visited entry, end if it is gone or moved
+        cursor.compactions = compactions_;
+        if (!cursor.visited)
+            cursor.seq = numeric_limits<qint64>::max();
+        else if (auto it = positions_.find(cursor.id);
+                 it != positions_.end() && at(it->second).datetime == cursor.datetime)
+            cursor.seq = it->second - 1;
+        else
+            cursor.seq = front_seq_ - 1;
+    }
+    cursor.seq = min(cursor.seq, front_seq_ + (qint64)entries_.size() - 1);
+}
+
+void History::unindex(size_t hash, qint64 seq)
+{
+    for (auto [b, e] = index_.equal_range(hash); b != e; ++b)
+        if (b->second == seq)
+        {
+            index_.erase(b);
+            return;
+        }
+}
+
+void History::release(qint64 seq)
+{
+    auto &entry = at(seq);
+    removeFromMonth(entry);
+    unindex(entry.hash, seq);
+    positions_.erase(entry.id);
+    arena_.release(entry.text);
+    if (entry.spilled())
+        blobs_.release(entry.blob);
+    trigrams_.remove(entry.text.length);
+    entry.text.length = 0;
+    tombstones_.insert(seq);
+}
+
+void History::addToMonth(const ClipboardEntry &entry)
+{
+    const auto m = History::month(entry.datetime);
+    auto &month = months_.try_emplace(m, Month{m, 0, 0, entry.datetime}).first->second;
+    ++month.count;
+    month.digest += digest(entry);
+    month.newest = max(month.newest, entry.datetime);
+}
+
+void History::removeFromMonth(const ClipboardEntry &entry)
+{
+    // the newest timestamp is kept, i.e. an upper bound
+    if (auto it = months_.find(History::month(entry.datetime)); it == months_.end())
+        return;
+    else if (--it->second.count == 0)
+        months_.erase(it);
+    else
+        it->second.digest -= digest(entry);
+}
+
+void History::copyMonth(qint64 month, size_t count, vector<ClipboardEntry> &entries) const
+{
+    // found by binary search if in chronological order, verified by the count
+    auto in_month = [&](const ClipboardEntry &entry)
+    { return !entry.removed() && History::month(entry.datetime) == month; };
+    const auto first = partition_point(entries_.begin(), entries_.end(), [&](const auto &entry)
+                                       { return History::month(entry.datetime) < month; });
+    const auto last = partition_point(first, entries_.end(), [&](const auto &entry)
+                                      { return History::month(entry.datetime) <= month; });
+
+    entries.clear();
+    for (auto it = make_reverse_iterator(last); it != make_reverse_iterator(first); ++it)
+        if (in_month(*it))
+            entries.push_back(*it);
+
+    if (entries.size() != count)  // out of order, e.g. the clock changed
+    {
+        entries.clear();
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+            if (in_month(*it))
+                entries.push_back(*it);
+    }
+}
+
+vector<TextArena::Frozen> History::freezable() const
+{
+    if (compression_age_ > 0)
+        return arena_.freezable(QDateTime::currentSecsSinceEpoch() - compression_age_);
+    return {};
+}
+
+void History::freeze(const vector<TextArena::Frozen> &chunks) { arena_.freeze(chunks); }
+
+bool History::needsCompaction() const
+{
+    return (tombstones_.size() > size() && tombstones_.size() > 64)
+           || trigrams_.needsRebuild()
+           || arena_.deadSize() > arena_.liveSize()
+           || blobs_.deadSize() > blobs_.liveSize();
+}
+
+unique_ptr<History::Detached> History::compact(size_t first)
+{
+    // move the live entries starting at first and their text into a new
+    // generation, detach the old one
+    auto old = make_unique<Detached>();
+    old->entries.swap(entries_);
+    old->index.swap(index_);
+    old->positions.swap(positions_);
+    swap(old->arena, arena_);
+    tombstones_.clear();
+    months_.clear();
+    front_seq_ = 0;
+    ++compactions_;
+    ++generation_;
+
+    // ids are stable, the trigram index is rebuilt once it is mostly stale
+    const bool reindex = trigrams_.needsRebuild();
+    if (reindex)
+    {
+        trigrams_.clear();
+        ++index_generation_;
+    }
+    else
+        for (auto it = old->entries.cbegin(); it != old->entries.cbegin() + first; ++it)
+            if (!it->removed())
+                trigrams_.remove(it->text.length);
+
+    // external and compressed chunks are shared, not copied to the heap
+    TextArena::Cache cache;
+    TextArena::Moved moved;
+    vector<BlobStore::Ref*> blobs;
+    qint64 blob_bytes = 0;
+    for (auto it = old->entries.cbegin() + first; it != old->entries.cend(); ++it)
+        if (!it->removed())
+        {
+            const auto seq = (qint64)entries_.size();
+            auto &entry = entries_.emplace_back(*it);
+            entry.text = arena_.move(old->arena, it->text, it->datetime, moved);
+            index_.emplace(entry.hash, seq);
+            positions_.emplace(entry.id, seq);
+            addToMonth(entry);
+            if (reindex)
+                trigrams_.add(entry.id, old->arena.view(it->text, cache));
+            if (entry.spilled())
+            {
+                blobs.push_back(&entry.blob);
+                blob_bytes += entry.blob.length * (qint64)sizeof(char16_t);
+            }
+        }
+
+    blobs_.retain(blob_bytes);
+    if (blobs_.deadSize() > blobs_.liveSize())
+        blobs_.compact(blobs);
+
+    return old;
+}
@@ -0,0 +1,343 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include "blobstore.h"
+#include "textarena.h"
+#include "tombstones.h"
+#include "trigramindex.h"
+#include <QString>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+
+struct ClipboardEntry
+{
+    TextArena::Ref text;  // the text or a preview if spilled, zero length for removed entries
+    BlobStore::Ref blob;  // the full text if spilled, zero length otherwise
+    quint64 id;  // stable and unique, persisted
+    qint64 datetime;  // seconds since epoch
+    size_t hash;  // of the full text
+
+    bool removed() const { return text.length == 0; }
+    bool spilled() const { return blob.length != 0; }
+};
+
+
+///
+/// The clipboard history.
+///
+/// Entries are stored oldest first in a deque, i.e. a ring of fixed size
+/// segments, such that adding new and dropping old entries is O(1) and scans
+/// walk contiguous memory. The text lives in a TextArena. Texts above the
+/// spill threshold are written to a BlobStore, only a preview stays resident.
+/// Arena chunks holding entries older than the compression age get compressed
+/// off the lock by the owner, see freezable.
+/// Duplicates are found in O(1) using a content hash index, entries by their
+/// stable id in O(1) using an id index. Removed entries
+/// leave tombstones which are dropped when they reach the tail or compacted
+/// away together with the arena once they outnumber the live entries.
+/// Substring queries find their candidates using a TrigramIndex over the
+/// resident text. Persisted indexes over the full text can be merged.
+///
+/// Not thread-safe.
+///
+class History
+{
+public:
+
+    /// Storage detached from the history. Potentially large, free it off the lock.
+    struct Detached
+    {
+        std::deque<ClipboardEntry> entries;
+        std::unordered_multimap<size_t, qint64> index;
+        std::unordered_map<quint64, qint64> positions;
+        TextArena arena;
+    };
+
+    /// The live entries of a calendar month, summarized.
+    struct Month
+    {
+        qint64 month;  // months since year 0, UTC
+        size_t count;
+        quint64 digest;  // of the ids and timestamps, order independent
+        qint64 newest;  // the most recent timestamp, an upper bound
+    };
+
+    ///
+    /// A consistent read-only copy of the history, e.g. to write it off the
+    /// lock. Holds the entry metadata partitioned by month, of all or some
+    /// months, and shares the text, i.e. modifications, compactions and
+    /// freezing of the history do not affect it.
+    ///
+    class View
+    {
+    public:
+
+        /// The id the next new entry gets.
+        quint64 nextId() const { return next_id_; }
+
+        /// The age in seconds after which the resident text is compressed.
+        qint64 compressionAge() const { return compression_age_; }
+
+        /// The months holding live entries, most recent first, including the
+        /// ones whose entries have not been copied.
+        const std::vector<Month> &months() const { return months_; }
+
+        /// Returns true if the entries of _month_ have been copied.
+        bool contains(qint64 month) const { return entries_.contains(month); }
+
+        /// Returns the full text of _entry_, reading it from disk if spilled.
+        QString text(const ClipboardEntry &entry) const;
+
+        /// Calls _f_ with every live entry of _month_ and a view of its resident
+        /// text, most recent first, while _f_ returns true. The view is valid
+        /// during the call only.
+        template<class F>
+        void forEach(qint64 month, F &&f) const
+        {
+            TextArena::Cache cache;
+            if (auto it = entries_.find(month); it != entries_.end())
+                for (const auto &entry : it->second)
+                    if (!f(entry, arena_.view(entry.text, cache)))
+                        return;
+        }
+
+    private:
+
+        friend class History;
+        std::vector<Month> months_;
+        std::unordered_map<qint64, std::vector<ClipboardEntry>> entries_;  // most recent first
+        TextArena arena_;
+        BlobStore::Reader blobs_;
+        quint64 next_id_ = 0;
+        qint64 compression_age_ = 0;
+
+    };
+
+    /// The position of a scan continued across calls of forEach. Entries
+    /// added or moved meanwhile are not visited, removed ones are skipped.
+    class Cursor
+    {
+        friend class History;
+        qint64 seq = std::numeric_limits<qint64>::max();  // of the next entry
+        quint64 compactions = 0;  // when seq was taken
+        quint64 id;  // of the last visited entry, relocates seq after a compaction
+        qint64 datetime;
+        bool visited = false;
+    };
+
+    /// Constructs a history spilling large texts to _blob_file_.
+    explicit History(QString blob_file);
+
+    /// The content hash used by the history. Stable across sessions.
+    static size_t hash(QStringView text);
+
+    /// The month of _datetime_ in seconds since epoch, in months since year 0,
+    /// UTC.
+    static qint64 month(qint64 datetime);
+
+    /// The number of live entries.
+    size_t size() const;
+
+    /// A number changing with every modification of the history.
+    quint64 generation() const;
+
+    /// The id the next new entry gets.
+    quint64 nextId() const;
+
+    /// Makes sure new entries get ids greater or equal _id_. Used for loading.
+    void reserveIds(quint64 id);
+
+    /// The bytes of resident memory used by the live entries, including their
+    /// indexes and text.
+    size_t memoryUsage() const;
+
+    /// Sets the text size in bytes above which texts are spilled to disk.
+    /// Zero disables spilling. Affects new entries only.
+    void setSpillThreshold(qint64 bytes);
+
+    /// The age in seconds after which the resident text is compressed.
+    qint64 compressionAge() const;
+
+    /// Sets the age in seconds after which the resident text is compressed.
+    /// Zero disables compression.
+    void setCompressionAge(qint64 seconds);
+
+    /// Returns the arena chunks holding text older than the compression age
+    /// only. Compress them off the lock using TextArena::compress, then pass
+    /// them to freeze.
+    std::vector<TextArena::Frozen> freezable() const;
+
+    /// Replaces the arena chunks by their compressed _chunks_, unless they
+    /// changed meanwhile.
+    void freeze(const std::vector<TextArena::Frozen> &chunks);
+
+    /// Adds _text_ as the most recent entry or moves an existing duplicate there.
+    /// Returns the id of the entry. Does not compact, see truncate.
+    quint64 add(QStringView text, qint64 datetime);
+
+    /// Like add, but new entries get _id_. Used for loading.
+    quint64 add(QStringView text, qint64 datetime, quint64 id);
+
+    /// Adds _text_ with _id_ as the oldest entry unless it exists already.
+    /// The text is not indexed if _indexed_, i.e. addIndex added its postings.
+    /// Used for loading.
+    void addOldest(QStringView text, qint64 datetime, quint64 id, bool indexed = false);
+
+    /// Adds read-only external _text_, e.g. a mapped file, to the arena.
+    /// _owner_ keeps the text alive. Returns a chunk handle for addOldest.
+    quint32 addExternalText(QStringView text, std::shared_ptr<const void> owner);
+
+    /// Adds text of _size_ code units, _compressed_ using the preset _dictionary_,
+    /// e.g. read from a file, to the arena. Returns a chunk handle for addOldest.
+    quint32 addCompressedText(QByteArray compressed, quint32 size,
+                              std::shared_ptr<const QByteArray> dictionary);
+
+    /// Like addOldest, but uses _length_ code units at _offset_ in the external
+    /// or compressed _chunk_ in place instead of copying them. _hash_ is the
+    /// hash of the text, which is not touched unless needed, then compressed
+    /// chunks are decompressed into _cache_. Pass the same cache for a batch
+    /// of entries, such that each chunk is decompressed once. The cache is
+    /// invalid once the history is modified otherwise.
+    void addOldest(quint32 chunk, quint32 offset, quint32 length, qint64 datetime,
+                   quint64 id, size_t hash, TextArena::Cache &cache, bool indexed = false);
+
+    /// Returns true if there is an entry with _id_.
+    bool contains(quint64 id) const;
+
+    /// Removes the entry with _id_. Returns true if the entry existed. Does not
+    /// compact, see truncate.
+    bool remove(quint64 id);
+
+    /// Drops the oldest entries until at most _limit_ entries using at most
+    /// _bytes_ of memory are left. Not O(1), the work is proportional to the
+    /// number of entries of the smaller of the kept and the dropped part. Text
+    /// is not copied but for partly dropped arena chunks. The storage of the
+    /// dropped part may be returned detached. Compacts if the removed entries
+    /// outweigh the live ones, the old generation is returned detached then.
+    [[nodiscard]] std::unique_ptr<Detached> truncate(size_t limit, size_t bytes);
+
+    /// Returns the full text of _entry_, reading it from disk if spilled.
+    QString text(const ClipboardEntry &entry) const;
+
+    /// Returns the full text of the entry with _id_ or a null string if there
+    /// is no such entry.
+    QString text(quint64 id) const;
+
+    /// Returns the resident text of the entry with _id_, i.e. a preview if it
+    /// is spilled, or a null string if there is no such entry.
+    QString resident(quint64 id) const;
+
+    /// The months holding live entries, most recent first. O(months).
+    std::vector<Month> months() const;
+
+    /// Returns a view of the current state. O(n) in the live entries, the text
+    /// is shared.
+    View view() const;
+
+    /// Like view, but copies the entries of _months_ only. O(log n) plus the
+    /// entries of those months as long as the entries are in chronological
+    /// order, a month out of order is scanned for.
+    View view(std::span<const qint64> months) const;
+
+    /// Calls _f_ with every live entry and a view of its resident text, most
+    /// recent first. The view is valid during the call only.
+    template<class F>
+    void forEach(F &&f) const
+    {
+        TextArena::Cache cache;
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+            if (!it->removed())
+                f(*it, arena_.view(it->text, cache));
+    }
+
+    /// Like forEach, but for at most _count_ live entries starting at _cursor_,
+    /// which is advanced. Returns false if the scan reached the end.
+    template<class F>
+    bool forEach(Cursor &cursor, size_t count, F &&f) const
+    {
+        seek(cursor);
+        TextArena::Cache cache;
+        for (; count && cursor.seq >= front_seq_; --cursor.seq)
+            if (const auto &entry = at(cursor.seq); !entry.removed())
+            {
+                f(entry, arena_.view(entry.text, cache));
+                cursor.id = entry.id;
+                cursor.datetime = entry.datetime;
+                cursor.visited = true;
+                --count;
+            }
+        return cursor.seq >= front_seq_;
+    }
+
+    /// Calls _f_ with the rank, i.e. the position among the live entries most
+    /// recent first counting from one, the live entry and a view of its
+    /// resident text for each of _ids_ still in the history, in order.
+    template<class F>
+    void forEach(std::span<const quint64> ids, F &&f) const
+    {
+        TextArena::Cache cache;
+        for (const auto id : ids)
+            if (auto it = positions_.find(id); it != positions_.end())
+                f(rank(it->second), at(it->second), arena_.view(at(it->second).text, cache));
+    }
+
+    /// Returns the ids of the entries which may contain the words of _query_,
+    /// most recent first, or null if any entry may. A superset of the entries
+    /// matching _query_ unless it is matched fuzzily. Returns null as well if
+    /// there may be more than _limit_, i.e. scanning is cheaper than sorting.
+    std::optional<std::vector<quint64>> candidates(QStringView query, size_t limit) const;
+
+    /// Adds the postings _ids_ of the trigram _key_ of a persisted index, e.g.
+    /// for the entries added as the oldest with indexed set. Entries need not
+    /// exist yet, postings of ids never added are stale. Used for loading.
+    void addIndex(quint64 key, std::span<const quint64> ids);
+
+    /// Accounts _count_ postings added by addIndex as stale, i.e. of ids which
+    /// will not be added. Used for loading.
+    void discardIndex(quint64 count);
+
+    /// A number changing whenever the trigram index is rebuilt, i.e. postings
+    /// added by addIndex for entries not added yet are lost.
+    quint64 indexGeneration() const;
+
+private:
+
+    ClipboardEntry makeEntry(QStringView text, qint64 datetime, size_t hash, quint64 id);
+    qint64 find(QStringView text, size_t hash) const;
+    ClipboardEntry &at(qint64 seq);
+    const ClipboardEntry &at(qint64 seq) const;
+    void seek(Cursor &cursor) const;
+    void indexText(const ClipboardEntry &entry, QStringView text);
+    size_t rank(qint64 seq) const;
+    void unindex(size_t hash, qint64 seq);
+    void release(qint64 seq);
+    void addToMonth(const ClipboardEntry &entry);
+    void removeFromMonth(const ClipboardEntry &entry);
+    void copyMonth(qint64 month, size_t count, std::vector<ClipboardEntry> &entries) const;
+    bool needsCompaction() const;
+    std::unique_ptr<Detached> compact(size_t first = 0);
+
+    std::deque<ClipboardEntry> entries_;
+    std::unordered_multimap<size_t, qint64> index_;  // hash -> sequence number
+    std::unordered_map<quint64, qint64> positions_;  // id -> sequence number
+    Tombstones tombstones_;  // sequence numbers of the removed entries
+    std::map<qint64, Month, std::greater<>> months_;  // of the live entries
+    TrigramIndex trigrams_;
+    quint64 index_generation_ = 0;
+    TextArena arena_;
+    BlobStore blobs_;
+    qint64 spill_threshold_ = 0;
+    qint64 compression_age_ = 0;
+    qint64 front_seq_ = 0;  // sequence number of entries_.front()
+    quint64 next_id_ = 0;
+    quint64 compactions_ = 0;  // which renumber the entries
+    quint64 generation_ = 0;
+
+};
@@ -0,0 +1,423 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "crc32c.h"
+#include "history.h"
+#include "journal.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace Qt::StringLiterals;
+using namespace std;
+
+static constexpr quint32 magic = 0x434c504a;  // CLPJ
+static constexpr quint32 version = 4;
+static constexpr quint32 sync_marker = 0xc1b05e7a;  // starts each record
+static constexpr auto stream_version = QDataStream::Qt_6_0;
+static constexpr qint64 header_size = 2 * sizeof(quint32) + sizeof(quint64);
+static constexpr qint64 frame_size = 3 * sizeof(quint32);  // marker, length and checksum
+
+// unique per truncation, no need to be monotonic
+static quint64 newGeneration() { return (quint64)QDateTime::currentMSecsSinceEpoch(); }
+
+static bool syncToDisk(QFileDevice &file)
+{
+#if defined(Q_OS_MAC)
+    return ::fcntl(file.handle(), F_FULLFSYNC) != -1;
+#elif defined(Q_OS_UNIX)
+    return ::fdatasync(file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+// reads the header of the journal _data_. returns false if it is not valid.
+static bool readHeader(QByteArrayView data, quint64 &generation)
+{
+    if (data.size() < header_size
+        || qFromBigEndian<quint32>(data.data()) != magic
+        || qFromBigEndian<quint32>(data.data() + sizeof(quint32)) != version)
+        return false;
+    generation = qFromBigEndian<quint64>(data.data() + 2 * sizeof(quint32));
+    return true;
+}
+
+// calls f with the payload of each intact record of the journal _data_ from
+// _offset_ on. a damaged length or checksum loses the framing, resyncs at the
+// next marker and counts the skipped stretch as _damaged_. returns the end of
+// the last intact record, i.e. the start of a torn or damaged tail.
+template<class F>
+static qint64 scan(QByteArrayView data, qint64 offset, uint &damaged, F &&f)
+{
+    const auto marker = qToBigEndian(sync_marker);
+    const QByteArrayView marker_bytes(reinterpret_cast<const char*>(&marker), sizeof(marker));
+    qint64 end = offset;
+    while (data.size() - offset >= frame_size)
+    {
+        const auto frame = data.data() + offset;
+        const auto length = qFromBigEndian<quint32>(frame + sizeof(quint32));
+        const auto crc = qFromBigEndian<quint32>(frame + 2 * sizeof(quint32));
+
+        // the checksum covers the length, markers in the text fail it
+        if (qFromBigEndian<quint32>(frame) == sync_marker
+            && (qint64)length <= data.size() - offset - frame_size
+            && crc == crc32c(frame + frame_size, length,
+                             crc32c(frame + sizeof(quint32), sizeof(quint32))))
+        {
+            if (offset != end)
+                ++damaged;
+            f(data.sliced(offset + frame_size, length));
+            end = offset += frame_size + length;
+        }
+        else if (offset = data.indexOf(marker_bytes, offset + 1); offset < 0)
+            break;
+    }
+    return end;
+}
+
+Journal::Journal(QString path) : file_(::move(path))
+{
+    buffer_.open(QIODevice::WriteOnly);
+    stream_.setDevice(&buffer_);
+    stream_.setVersion(stream_version);
+    writer_ = thread([this]{ write(); });
+}
+
+Journal::~Journal()
+{
+    {
+        lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    requested_cv_.notify_one();
+    writer_.join();
+}
+
+void Journal::setSyncPolicy(SyncPolicy policy)
+{
+    lock_guard lock(mutex_);
+    sync_ = policy;
+}
+
+bool Journal::open()
+{
+    lock_guard file_lock(file_mutex_);
+    return openFile();
+}
+
+bool Journal::openFile()
+{
+    QFileInfo(file_).dir().mkpath(u"."_s);
+    if (!file_.open(QIODevice::ReadWrite | QIODevice::Append))
+        return false;
+
+    // start over if the file has no valid header, replays skip it anyway.
+    // drop a torn record at the end, records appended to it would be lost.
+    qint64 end = 0;
+    quint64 generation = 0;
+    QFile file(file_.fileName());
+    if (file.open(QIODevice::ReadOnly) && file.size() > 0)
+        if (const auto data = file.map(0, file.size()))
+        {
+            const QByteArrayView view(data, file.size());
+            uint damaged = 0;
+            if (readHeader(view, generation))
+                end = scan(view, header_size, damaged, [](QByteArrayView){});
+            file.unmap(data);
+        }
+
+    if (end == 0)
+    {
+        if (!file_.resize(0)
+            || !writeHeader(&file_, generation = newGeneration())
+            || !file_.flush())
+        {
+            file_.close();
+            return false;
+        }
+    }
+    else if (end < file_.size() && !file_.resize(end))
+    {
+        file_.close();
+        return false;
+    }
+
+    lock_guard lock(mutex_);
+    generation_ = generation;
+    size_ = file_.size() + buffer_.size();
+    return true;
+}
+
+void Journal::close()
+{
+    flush();
+    lock_guard file_lock(file_mutex_);
+    file_.close();
+}
+
+Journal::Position Journal::position() const
+{
+    lock_guard lock(mutex_);
+    return {generation_, size_};
+}
+
+bool Journal::discard(Position position)
+{
+    if (!flush())
+        return false;
+
+    // the records buffered meanwhile are appended to the new file
+    lock_guard file_lock(file_mutex_);
+    {
+        lock_guard lock(mutex_);
+        if (!file_.isOpen() || position.generation != generation_
+            || position.offset < header_size || position.offset > size_)
+            return false;
+    }
+
+    // records journaled while the snapshot was written
+    QFile file(file_.fileName());
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(position.offset))
+        return false;
+    const auto tail = file.readAll();
+    file.close();
+
+    // replace atomically, a crash keeps either journal
+    QSaveFile out(file_.fileName());
+    const auto generation = newGeneration();
+    if (!out.open(QIODevice::WriteOnly)
+        || !writeHeader(&out, generation)
+        || out.write(tail) != tail.size()
+        || !out.commit())
+        return false;
+
+    // reopen, the file has been replaced
+    file_.close();
+    if (!openFile())
+        return false;
+
+    lock_guard lock(mutex_);
+    return generation_ == generation;
+}
+
+qint64 Journal::size() const
+{
+    lock_guard lock(mutex_);
+    return size_;
+}
+
+bool Journal::isEmpty() const { return size() <= header_size; }
+
+bool Journal::isDirty() const
+{
+    lock_guard lock(mutex_);
+    return buffer_.size() > 0;
+}
+
+bool Journal::writeHeader(QIODevice *device, quint64 generation)
+{
+    QDataStream stream(device);
+    stream.setVersion(stream_version);
+    stream << magic << version << generation;
+    return stream.status() == QDataStream::Ok;
+}
+
+void Journal::add(quint64 id, qint64 datetime, const QString &text)
+{ append(Op::Add, id, datetime, text); }
+
+void Journal::remove(quint64 id) { append(Op::Remove, id); }
+
+void Journal::truncate(quint64 size) { append(Op::Truncate, size); }
+
+template<class... Args>
+void Journal::append(Op op, const Args &...args)
+{
+    // framed by a marker, the length and the checksum, replays resync after
+    // damaged records
+    QByteArray record;
+    QDataStream record_stream(&record, QIODevice::WriteOnly);
+    record_stream.setVersion(stream_version);
+    record_stream << (quint8)op;
+    (record_stream << ... << args);
+
+    const auto length = qToBigEndian((quint32)record.size());
+    const auto crc = crc32c(record.constData(), (size_t)record.size(),
+                            crc32c(&length, sizeof(length)));
+
+    {
+        lock_guard lock(mutex_);
+        stream_ << sync_marker << (quint32)record.size() << crc;
+        stream_.writeRawData(record.constData(), (int)record.size());
+        size_ += frame_size + record.size();
+        if (sync_ != SyncPolicy::Immediate)
+            return;
+        ++requested_;
+    }
+    requested_cv_.notify_one();
+}
+
+void Journal::commit()
+{
+    {
+        lock_guard lock(mutex_);
+        ++requested_;
+    }
+    requested_cv_.notify_one();
+}
+
+bool Journal::flush()
+{
+    unique_lock lock(mutex_);
+    const auto request = ++requested_;
+    requested_cv_.notify_one();
+    committed_cv_.wait(lock, [&]{ return committed_ >= request; });
+    return !exchange(failed_, false);
+}
+
+bool Journal::commitFailed()
+{
+    lock_guard lock(mutex_);
+    return exchange(failed_, false);
+}
+
+void Journal::write()
+{
+    for (;;)
+    {
+        quint64 request;
+        {
+            unique_lock lock(mutex_);
+            requested_cv_.wait(lock, [this]{ return requested_ > committed_ || stop_; });
+            if (requested_ == committed_)
+                return;
+        }
+
+        // a failed commit loses the buffered records, however keeps the file
+        // consistent, replays stop at incomplete records. the buffer is taken
+        // under the file lock, i.e. reopening accounts all records.
+        lock_guard file_lock(file_mutex_);
+        QByteArray records;
+        SyncPolicy sync;
+        {
+            lock_guard lock(mutex_);
+            request = requested_;
+            records = buffer_.buffer();
+            buffer_.buffer().clear();
+            buffer_.seek(0);
+            sync = sync_;
+        }
+
+        const bool ok = records.isEmpty()
+                        || (file_.isOpen()
+                            && file_.write(records) == records.size()
+                            && file_.flush()
+                            && (sync == SyncPolicy::None || syncToDisk(file_)));
+
+        {
+            lock_guard lock(mutex_);
+            committed_ = request;
+            failed_ = failed_ || !ok;
+        }
+        committed_cv_.notify_all();
+    }
+}
+
+Journal::Replay Journal::replay(const QString &path, History &history, quint64 snapshot_ids,
+                                Position snapshot_position)
+{
+    Replay replay;
+
+    // a snapshot entry left the snapshot part of the history
+    auto leave = [&]
+    {
+        if (replay.snapshot_limit != numeric_limits<size_t>::max() && replay.snapshot_limit)
+            --replay.snapshot_limit;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return replay;
+
+    const auto data = file.map(0, file.size());
+    if (!data)
+        return replay;
+    const QByteArrayView view(data, file.size());
+
+    quint64 generation;
+    if (!readHeader(view, generation))
+    {
+        file.unmap(data);
+        return replay;
+    }
+
+    // the snapshot contains the records up to its position. a different
+    // generation means the journal has been truncated after the snapshot.
+    qint64 offset = header_size;
+    if (generation == snapshot_position.generation
+        && snapshot_position.offset > header_size)
+        offset = min(snapshot_position.offset, view.size());
+
+    scan(view, offset, replay.damaged, [&](QByteArrayView record)
+    {
+        QDataStream in(QByteArray::fromRawData(record.data(), record.size()));
+        in.setVersion(stream_version);
+
+        quint8 op;
+        in >> op;
+
+        if (op == (quint8)Op::Add)
+        {
+            quint64 id;
+            qint64 datetime;
+            QString text;
+            in >> id >> datetime >> text;
+            if (in.status() == QDataStream::Ok)
+            {
+                if (id < snapshot_ids && !history.contains(id))
+                    leave();  // moved to the front
+                history.add(text, datetime, id);
+            }
+        }
+        else if (op == (quint8)Op::Remove)
+        {
+            quint64 id;
+            in >> id;
+            if (in.status() == QDataStream::Ok)
+            {
+                if (!history.remove(id))
+                    leave();
+                replay.removed.insert(id);
+            }
+        }
+        else if (op == (quint8)Op::Truncate)
+        {
+            quint64 size;
+            in >> size;
+            if (in.status() == QDataStream::Ok)
+            {
+                // snapshot entries are the oldest, they survive if there is room
+                replay.snapshot_limit = min(replay.snapshot_limit,
+                                            size > history.size() ? size - history.size() : 0);
+                (void)history.truncate(size, numeric_limits<size_t>::max());
+            }
+        }
+        else
+            in.setStatus(QDataStream::ReadCorruptData);
+
+        if (in.status() != QDataStream::Ok)
+            ++replay.damaged;
+        else
+            ++replay.count;
+    });
+
+    file.unmap(data);
+    return replay;
+}
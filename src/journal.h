@@ -0,0 +1,148 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+class History;
+
+
+///
+/// Append-only log of history modifications.
+///
+/// Records the modifications since the last snapshot, such that they survive
+/// a crash and writing the history costs O(1) per modification. Records are
+/// framed by a sync marker, their length and a CRC-32C covering both. Replays
+/// skip damaged records, resyncing at the next marker if the length is
+/// damaged, and stop at an incomplete one at the end. Thread-safe, however
+/// callers serialize writes and position() with the modifications they record.
+///
+/// Records are buffered until they are committed, such that bursts of
+/// modifications cost one write and one sync. Commits run on a writer
+/// thread, i.e. neither appending nor committing waits for the disk.
+///
+class Journal
+{
+public:
+
+    /// When commits sync the file to disk.
+    enum class SyncPolicy : uint
+    {
+        None,      // leave it to the OS
+        Batched,   // on each commit
+        Immediate  // commit and sync each record
+    };
+
+    explicit Journal(QString path);
+    ~Journal();
+
+    /// Sets the sync policy, defaults to Batched.
+    void setSyncPolicy(SyncPolicy policy);
+
+    /// Opens the journal for appending. Drops incomplete or damaged records at
+    /// the end, e.g. of a crash while writing. Returns false on failure.
+    bool open();
+
+    /// Flushes the buffered records and closes the journal.
+    void close();
+
+    /// Hands the buffered records to the writer thread, which writes them to
+    /// the file and syncs it according to the sync policy. With the Immediate
+    /// policy each record is committed as it is added.
+    void commit();
+
+    /// Commits the buffered records and waits for the writer thread. Returns
+    /// false if a commit failed since the last check.
+    bool flush();
+
+    /// Returns true if a commit failed since the last check, i.e. records
+    /// have been lost.
+    bool commitFailed();
+
+    /// Returns true if there are records to commit.
+    bool isDirty() const;
+
+    /// A position in the journal. Each truncation starts a new generation.
+    struct Position
+    {
+        quint64 generation = 0;
+        qint64 offset = 0;
+    };
+
+    /// The end of the journal, i.e. the position after the last record,
+    /// committed or not.
+    Position position() const;
+
+    /// Drops the records before _position_, e.g. after a snapshot containing
+    /// them has been written. Keeps the records following it in a new
+    /// generation. Returns false on failure or if _position_ is stale.
+    bool discard(Position position);
+
+    /// The size of the journal in bytes, including uncommitted records.
+    qint64 size() const;
+
+    /// Returns true if the journal holds no records.
+    bool isEmpty() const;
+
+    /// Records adding or moving the entry _id_ to the front.
+    void add(quint64 id, qint64 datetime, const QString &text);
+
+    /// Records removing the entry _id_.
+    void remove(quint64 id);
+
+    /// Records truncating the history to _size_ entries.
+    void truncate(quint64 size);
+
+    /// The outcome of a replay onto a history lacking the snapshot entries.
+    struct Replay
+    {
+        uint count = 0;  // replayed records
+        uint damaged = 0;  // skipped stretches of damaged records
+        std::unordered_set<quint64> removed;  // ids of removed entries
+        size_t snapshot_limit = std::numeric_limits<size_t>::max();  // entries left by truncations
+    };
+
+    /// Replays the journal at _path_ onto _history_, which does not contain
+    /// the snapshot entries with ids below _snapshot_ids_ yet. Journaled entries
+    /// are more recent than the snapshot entries, i.e. the latter can be added
+    /// as older entries later, skipping the removed ones and stopping at the
+    /// snapshot limit. Skips the records up to _snapshot_position_, which the
+    /// snapshot contains already.
+    static Replay replay(const QString &path, History &history, quint64 snapshot_ids,
+                         Position snapshot_position = {});
+
+private:
+
+    enum class Op : quint8 { Add, Remove, Truncate };
+
+    bool openFile();
+    bool writeHeader(QIODevice *device, quint64 generation);
+    template<class... Args>
+    void append(Op op, const Args &...args);
+    void write();  // the writer thread
+
+    // file_mutex_ before mutex_. the file is written under file_mutex_ only,
+    // the rest is guarded by mutex_.
+    std::mutex file_mutex_;
+    QFile file_;
+    mutable std::mutex mutex_;
+    QBuffer buffer_;
+    QDataStream stream_;
+    SyncPolicy sync_ = SyncPolicy::Batched;
+    quint64 generation_ = 0;
+    qint64 size_ = 0;
+    std::condition_variable requested_cv_;
+    std::condition_variable committed_cv_;
+    quint64 requested_ = 0;  // commits
+    quint64 committed_ = 0;
+    bool failed_ = false;
+    bool stop_ = false;
+    std::thread writer_;
+
+};
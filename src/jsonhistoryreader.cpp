@@ -0,0 +1,263 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "jsonhistoryreader.h"
+#include <QIODevice>
+using namespace std;
+
+static constexpr qint64 buffer_size = 64 * 1024;
+
+JsonHistoryReader::JsonHistoryReader(QIODevice *device) : device_(device) {}
+
+bool JsonHistoryReader::hasError() const { return error_; }
+
+bool JsonHistoryReader::next(Entry &entry, bool decode_text)
+{
+    if (done_)
+        return false;
+
+    skipWhitespace();
+    if (!started_)
+    {
+        started_ = true;
+        if (!expect('['))
+            return done_ = true, error_ = true, false;
+        skipWhitespace();
+        if (peek() == ']')
+            return done_ = true, false;
+    }
+    else if (peek() == ',')
+        get();
+    else
+    {
+        error_ = !expect(']');
+        return done_ = true, false;
+    }
+
+    entry = {};
+    skipWhitespace();
+    if (!expect('{'))
+        return done_ = true, error_ = true, false;
+
+    skipWhitespace();
+    if (peek() == '}')
+        get();
+    else
+        for (;;)
+        {
+            QByteArray key;
+            skipWhitespace();
+            if (!readString(&key))
+                return done_ = true, error_ = true, false;
+
+            skipWhitespace();
+            if (!expect(':'))
+                return done_ = true, error_ = true, false;
+            skipWhitespace();
+
+            bool ok;
+            if (key == "text" && peek() == '"')
+            {
+                QByteArray utf8;
+                ok = readString(decode_text ? &utf8 : nullptr);
+                entry.text = QString::fromUtf8(utf8);
+            }
+            else if (key == "datetime" && peek() != '"')
+                ok = readNumber(entry.datetime);
+            else if (key == "id" && peek() != '"')
+            {
+                qint64 id;
+                if ((ok = readNumber(id)))
+                    entry.id = id;
+            }
+            else
+                ok = skipValue();
+
+            if (!ok)
+                return done_ = true, error_ = true, false;
+
+            skipWhitespace();
+            if (const auto c = get(); c == '}')
+                break;
+            else if (c != ',')
+                return done_ = true, error_ = true, false;
+        }
+
+    return true;
+}
+
+int JsonHistoryReader::peek()
+{
+    if (pos_ == buffer_.size())
+    {
+        buffer_ = device_->read(buffer_size);
+        pos_ = 0;
+        if (buffer_.isEmpty())
+            return -1;
+    }
+    return (uchar)buffer_[pos_];
+}
+
+int JsonHistoryReader::get()
+{
+    const auto c = peek();
+    if (c != -1)
+        ++pos_;
+    return c;
+}
+
+bool JsonHistoryReader::expect(char c) { return get() == (uchar)c; }
+
+void JsonHistoryReader::skipWhitespace()
+{
+    for (auto c = peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t'; c = peek())
+        get();
+}
+
+static void appendUtf8(QByteArray &utf8, char32_t c)
+{
+    if (c < 0x80)
+        utf8 += (char)c;
+    else if (c < 0x800)
+    {
+        utf8 += (char)(0xc0 | c >> 6);
+        utf8 += (char)(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+        utf8 += (char)(0xe0 | c >> 12);
+        utf8 += (char)(0x80 | (c >> 6 & 0x3f));
+        utf8 += (char)(0x80 | (c & 0x3f));
+    }
+    else
+    {
+        utf8 += (char)(0xf0 | c >> 18);
+        utf8 += (char)(0x80 | (c >> 12 & 0x3f));
+        utf8 += (char)(0x80 | (c >> 6 & 0x3f));
+        utf8 += (char)(0x80 | (c & 0x3f));
+    }
+}
+
+bool JsonHistoryReader::readString(QByteArray *utf8)
+{
+    if (!expect('"'))
+        return false;
+
+    auto hex4 = [this](char32_t &u)
+    {
+        u = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const auto c = get();
+            u <<= 4;
+            if (c >= '0' && c <= '9')
+                u |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                u |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                u |= c - 'A' + 10;
+            else
+                return false;
+        }
+        return true;
+    };
+
+    for (;;)
+    {
+        const auto c = get();
+        if (c == -1)
+            return false;
+        else if (c == '"')
+            return true;
+        else if (c != '\\')
+        {
+            if (utf8)
+                *utf8 += (char)c;
+            continue;
+        }
+
+        char32_t u;
+        switch (get())
+        {
+        case '"':  u = '"'; break;
+        case '\\': u = '\\'; break;
+        case '/':  u = '/'; break;
+        case 'b':  u = '\b'; break;
+        case 'f':  u = '\f'; break;
+        case 'n':  u = '\n'; break;
+        case 'r':  u = '\r'; break;
+        case 't':  u = '\t'; break;
+        case 'u':
+            if (!hex4(u))
+                return false;
+            if (u >= 0xd800 && u < 0xdc00)  // high surrogate, expect the low one
+            {
+                char32_t low;
+                if (get() != '\\' || get() != 'u' || !hex4(low))
+                    return false;
+                u = low >= 0xdc00 && low < 0xe000
+                        ? 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00)
+                        : 0xfffd;
+            }
+            else if (u >= 0xdc00 && u < 0xe000)  // lone low surrogate
+                u = 0xfffd;
+            break;
+        default:
+            return false;
+        }
+
+        if (utf8)
+            appendUtf8(*utf8, u);
+    }
+}
+
+bool JsonHistoryReader::readNumber(qint64 &number)
+{
+    QByteArray literal;
+    for (auto c = peek(); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.'
+                          || c == 'e' || c == 'E'; c = peek())
+        literal += (char)get();
+
+    bool ok;
+    number = literal.toLongLong(&ok);
+    if (!ok)  // written as double, e.g. 1.7e+09
+        number = (qint64)literal.toDouble(&ok);
+    return ok;
+}
+
+bool JsonHistoryReader::skipValue()
+{
+    if (const auto c = peek(); c == '"')
+        return readString(nullptr);
+
+    // scalars and nested containers, strings may contain brackets
+    for (int depth = 0;;)
+        switch (const auto c = peek())
+        {
+        case -1:
+            return false;
+        case '"':
+            if (!readString(nullptr))
+                return false;
+            break;
+        case '[':
+        case '{':
+            get();
+            ++depth;
+            break;
+        case ']':
+        case '}':
+            if (depth == 0)
+                return true;
+            get();
+            if (--depth == 0)
+                return true;
+            break;
+        case ',':
+            if (depth == 0)
+                return true;
+            get();
+            break;
+        default:
+            get();
+        }
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <optional>
+class QIODevice;
+
+
+///
+/// Streaming reader for the legacy JSON history file.
+///
+/// Reads an array of objects with the keys "text", "datetime" and optionally
+/// "id" entry by entry from a device, using a fixed size buffer, such that
+/// memory does not grow with the size of the file. Unknown keys are skipped.
+///
+class JsonHistoryReader
+{
+public:
+
+    struct Entry
+    {
+        QString text;
+        qint64 datetime = 0;
+        std::optional<qint64> id;
+    };
+
+    explicit JsonHistoryReader(QIODevice *device);
+
+    /// Reads the next entry into _entry_. Skips decoding the text unless
+    /// _decode_text_ is set. Returns false at the end of the array or on errors.
+    bool next(Entry &entry, bool decode_text = true);
+
+    /// Returns true if reading stopped due to malformed input.
+    bool hasError() const;
+
+private:
+
+    int peek();
+    int get();
+    bool expect(char c);
+    void skipWhitespace();
+    bool readString(QByteArray *utf8);
+    bool readNumber(qint64 &number);
+    bool skipValue();
+
+    QIODevice *device_;
+    QByteArray buffer_;
+    qsizetype pos_ = 0;
+    bool started_ = false;
+    bool done_ = false;
+    bool error_ = false;
+
+};
@@ -1,67 +1,132 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
+#include "clipboarditem.h"
+#include "jsonhistoryreader.h"
 #include "plugin.h"
+#include "snapshot.h"
 #include <QCheckBox>
+#include <QComboBox>
 #include <QCoroGenerator>
+#include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFormLayout>
 #include <QGuiApplication>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonValue>
+#include <QHBoxLayout>
+#include <QLabel>
 #include <QSettings>
 #include <QSpinBox>
 #include <albert/icon.h>
 #include <albert/logging.h>
 #include <albert/matcher.h>
-#include <albert/plugin/snippets.h>
 #include <albert/standarditem.h>
-#include <albert/systemutil.h>
 #include <albert/widgetsutil.h>
+#include <future>
+#include <limits>
 #include <mutex>
 #include <shared_mutex>
+#include <span>
 ALBERT_LOGGING_CATEGORY("clipboard")
 using namespace Qt::StringLiterals;
 using namespace albert;
+using namespace std::chrono_literals;
 using namespace std;
 
 namespace {
-static const auto HISTORY_FILE_NAME  = u"clipboard_history"_s;
+static const auto LEGACY_FILE_NAME   = u"clipboard_history"_s;
+static const auto SNAPSHOT_FILE_NAME = u"clipboard_snapshot"_s;
 static const auto CFG_STORE_HISTORY  = u"persistent"_s;
 static const auto DEF_STORE_HISTORY  = false;
 static const auto CFG_HISTORY_LENGTH = u"history_length"_s;
 static const auto DEF_HISTORY_LENGTH = 100u;
-static const auto k_text             = u"text"_s;
-static const auto k_datetime         = u"datetime"_s;
+static const auto CFG_MEMORY_LIMIT   = u"memory_limit"_s;
+static const auto DEF_MEMORY_LIMIT   = 0u;  // unlimited
+static const auto CFG_SPILL_SIZE     = u"spill_threshold"_s;
+static const auto DEF_SPILL_SIZE     = 1024u;
+static const auto CFG_COMPRESS_AGE   = u"compression_age"_s;
+static const auto DEF_COMPRESS_AGE   = 7u;
+static const auto CFG_SHUTDOWN_TIME  = u"shutdown_budget"_s;
+static const auto DEF_SHUTDOWN_TIME  = 500u;
+static const auto CFG_SYNC_POLICY    = u"sync_policy"_s;
+static const auto DEF_SYNC_POLICY    = (uint)Journal::SyncPolicy::Batched;
+static const auto CFG_SQLITE         = u"sqlite"_s;
+static const auto DEF_SQLITE         = false;
+static const auto SQLITE_FILE_NAME   = u"clipboard.sqlite"_s;
+static const size_t SQLITE_PAGE_SIZE = 100;
+static const auto BLOB_FILE_NAME     = u"clipboard_blobs"_s;
+static const auto JOURNAL_FILE_NAME  = u"clipboard_journal"_s;
+static const auto JOURNAL_SLACK      = 1024 * 1024;
+static const auto IDLE_INTERVAL      = 10'000;
+static const auto COMMIT_DELAY       = 200;
+static const size_t LOAD_BATCH_SIZE  = 4096;
+static const size_t EAGER_SHARDS     = 2;  // months
+static const size_t SCAN_BATCH_SIZE  = 1000;  // entries per yield
+static const size_t CANDIDATE_LIMIT  = 64 * 1024;  // sorted on the first batch
+static const auto LAZY_LOAD_DELAY    = 30s;
+
+// zero is unlimited
+size_t memoryLimitBytes(uint mib)
+{ return mib ? (size_t)mib * 1024 * 1024 : numeric_limits<size_t>::max(); }
 }
 
 
 Plugin::Plugin():
-    clipboard(QGuiApplication::clipboard())
+    clipboard(QGuiApplication::clipboard()),
+    history(QDir(cacheLocation()).filePath(BLOB_FILE_NAME)),
+    journal(QDir(dataLocation()).filePath(JOURNAL_FILE_NAME))
 {
     auto s = settings();
     store_history_ = s->value(CFG_STORE_HISTORY, DEF_STORE_HISTORY).toBool();
     history_limit_ = s->value(CFG_HISTORY_LENGTH, DEF_HISTORY_LENGTH).toUInt();
-
-    if (store_history_)
+    memory_limit_ = s->value(CFG_MEMORY_LIMIT, DEF_MEMORY_LIMIT).toUInt();
+    spill_threshold_ = s->value(CFG_SPILL_SIZE, DEF_SPILL_SIZE).toUInt();
+    history.setSpillThreshold((qint64)spill_threshold_ * 1024);
+    compression_age_ = s->value(CFG_COMPRESS_AGE, DEF_COMPRESS_AGE).toUInt();
+    history.setCompressionAge((qint64)compression_age_ * 24 * 60 * 60);
+    shutdown_budget_ = s->value(CFG_SHUTDOWN_TIME, DEF_SHUTDOWN_TIME).toUInt();
+
+    // checkpoint once the user stopped copying
+    idle_timer.setSingleShot(true);
+    idle_timer.setInterval(IDLE_INTERVAL);
+    connect(&idle_timer, &QTimer::timeout, this, [this]{ checkpoint(true); });
+
+    // group commit, coalesces bursts of captures into one write and sync on
+    // the writer thread of the journal
+    sync_policy_ = s->value(CFG_SYNC_POLICY, DEF_SYNC_POLICY).toUInt();
+    journal.setSyncPolicy((Journal::SyncPolicy)sync_policy_);
+    commit_timer.setSingleShot(true);
+    commit_timer.setInterval(COMMIT_DELAY);
+    connect(&commit_timer, &QTimer::timeout, this, [this]{ journal.commit(); });
+
+    bool in_memory = true;
+#if defined(CLIPBOARD_SQLITE)
+    sqlite_ = s->value(CFG_SQLITE, DEF_SQLITE).toBool();
+    if (sqlite_)
     {
-        if (QFile file(QDir(dataLocation()).filePath(HISTORY_FILE_NAME));
-            file.open(QIODevice::ReadOnly | QIODevice::Text))
+        // not persisted unless the history is stored
+        sql = make_unique<SqlHistory>(store_history_
+                                      ? QDir(dataLocation()).filePath(SQLITE_FILE_NAME)
+                                      : QString());
+        if ((!store_history_ || QDir(dataLocation()).mkpath(u"."_s)) && sql->open())
+            in_memory = false;
+        else
         {
-            DEBG << "Reading clipboard history from" << file.fileName();
-            const auto arr = QJsonDocument::fromJson(file.readAll()).array();
-            for (const auto &value : arr)
-            {
-                const auto object = value.toObject();
-                history.emplace_back(object[k_text].toString(),
-                                     QDateTime::fromSecsSinceEpoch(object[k_datetime].toInt()));
-            }
-            file.close();
+            WARN << "Failed opening clipboard database, using the in-memory history.";
+            sql.reset();
         }
-        else
-            DEBG << "Failed reading from clipboard history.";
+    }
+#endif
+
+    if (store_history_ && in_memory)
+    {
+        if (!journal.open())
+            WARN << "Failed opening clipboard journal.";
+
+        loading = true;
+        loader = async(launch::async, [this, limit = (size_t)history_limit_,
+                                       bytes = memoryLimitBytes(memory_limit_)]
+                       { loadHistory(limit, bytes); });
     }
 
 #if defined(Q_OS_MAC)
@@ -77,97 +142,394 @@ Plugin::Plugin():
 
 Plugin::~Plugin()
 {
-    if (store_history_)
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    {
+        lock_guard lock(load_mutex);
+        stop_loading = true;
+    }
+    load_cv.notify_one();
+    if (loader.valid())
+        loader.wait();
+    if (compressor.valid())
+        compressor.wait();
+
+    // everything is journaled already, only the last group has to be
+    // committed. a running checkpoint may finish within the budget, cancel
+    // it otherwise
+    if (checkpointer.valid()
+        && checkpointer.wait_for(chrono::milliseconds(
+               max<qint64>(0, (qint64)shutdown_budget_ - elapsed.elapsed())))
+               != future_status::ready)
     {
-        QJsonArray array;
-        for (const auto &entry : history)
+        stop_checkpoint = true;
+        checkpointer.wait();
+        DEBG << "Canceled clipboard history checkpoint.";
+    }
+
+    journal.close();
+
+    DEBG << "Clipboard history shut down in" << elapsed.elapsed() << "ms";
+}
+
+void Plugin::loadHistory(size_t limit, size_t bytes)
+{
+    const QDir data_dir(dataLocation());
+
+    auto snapshot = Snapshot::open(data_dir.filePath(SNAPSHOT_FILE_NAME));
+    QFile legacy(data_dir.filePath(LEGACY_FILE_NAME));
+    bool legacy_valid = false;
+    quint64 snapshot_ids = 0;
+
+    if (snapshot)
+    {
+        DEBG << "Reading clipboard history from" << data_dir.filePath(SNAPSHOT_FILE_NAME);
+        if (snapshot->isRecovered())
+            WARN << "Damaged clipboard history manifest, recovered the shards.";
+        snapshot_ids = snapshot->nextId();
+    }
+    else if (QFile::exists(data_dir.filePath(SNAPSHOT_FILE_NAME)))
+        WARN << "Failed reading clipboard history from" << data_dir.filePath(SNAPSHOT_FILE_NAME);
+    else if (legacy.open(QIODevice::ReadOnly))
+    {
+        // stream the file, the ids have to be known before the replay, scan
+        // them without decoding the text first. old files have no ids.
+        DEBG << "Importing legacy clipboard history from" << legacy.fileName();
+        JsonHistoryReader reader(&legacy);
+        JsonHistoryReader::Entry entry;
+        for (quint64 i = 0; reader.next(entry, false); ++i)
+            snapshot_ids = max(snapshot_ids, (quint64)entry.id.value_or(i) + 1);
+        if (!(legacy_valid = !reader.hasError()))
+            WARN << "Malformed legacy clipboard history" << legacy.fileName();
+        legacy.seek(0);
+    }
+
+    // the journal holds the most recent modifications, replay it first such
+    // that recent entries are available right away
+    Journal::Replay replay;
+    {
+        lock_guard lock(mutex);
+        history.reserveIds(snapshot_ids);
+        replay = Journal::replay(data_dir.filePath(JOURNAL_FILE_NAME), history, snapshot_ids,
+                                 snapshot ? snapshot->journalPosition() : Journal::Position{});
+    }
+    if (replay.count)
+        DEBG << "Replayed" << replay.count << "journal records";
+    if (replay.damaged)
+        WARN << "Skipped" << replay.damaged << "damaged journal records";
+
+    // then stream in the older entries in batches, queries and captures
+    // interleave, stop once the limits are reached anyway
+    auto budget = replay.snapshot_limit;
+    auto more = [&]{ return budget && history.size() < limit && history.memoryUsage() < bytes; };
+
+    if (snapshot)
+        for (bool next = true; next && !stop_loading;)
         {
-            QJsonObject object;
-            object[k_text] = entry.text;
-            object[k_datetime] = entry.datetime.toSecsSinceEpoch();
-            array.append(object);
+            // recent months right away, older ones once queries reach them or
+            // the launcher has settled
+            if (snapshot->shardsRead() >= EAGER_SHARDS)
+            {
+                unique_lock lock(load_mutex);
+                load_cv.wait_for(lock, LAZY_LOAD_DELAY,
+                                 [this]{ return resume_loading || stop_loading; });
+                resume_loading = true;
+            }
+
+            lock_guard lock(mutex);
+            const auto size = history.size();
+            snapshot->read(history, min(LOAD_BATCH_SIZE, budget), replay.removed);
+            budget -= history.size() - size;
+            next = !snapshot->atEnd() && more();
         }
 
-        QDir data_dir = dataLocation();
-        if (data_dir.exists() || data_dir.mkpath(u"."_s))
+    else if (legacy.isOpen())
+    {
+        // entries go straight into the history, i.e. constant overhead
+        JsonHistoryReader reader(&legacy);
+        JsonHistoryReader::Entry entry;
+        bool next = true;
+        for (quint64 i = 0; next && !stop_loading;)
         {
-            if (QFile file(data_dir.filePath(HISTORY_FILE_NAME));
-                file.open(QIODevice::WriteOnly))
+            lock_guard lock(mutex);
+            for (const auto end = i + LOAD_BATCH_SIZE;
+                 i < end && budget && (next = reader.next(entry)); ++i)
             {
-                DEBG << "Writing clipboard history to" << file.fileName();
-                file.write(QJsonDocument(array).toJson());
-                file.close();
+                const auto id = (quint64)entry.id.value_or(i);
+                const auto size = history.size();
+                if (!replay.removed.contains(id))
+                    history.addOldest(entry.text, entry.datetime, id);
+                budget -= history.size() - size;
             }
-            else
-                WARN << "Failed creating history file:" << data_dir.path();
+            next = next && more();
         }
-        else
-            WARN << "Failed creating data dir" << data_dir.path();
+    }
+
+    // the index postings of the entries not read are stale
+    if (snapshot)
+    {
+        lock_guard lock(mutex);
+        snapshot->close(history);
+    }
+
+    if (snapshot && snapshot->damaged())
+        WARN << "Skipped" << snapshot->damaged() << "damaged clipboard history entries";
+
+    loading = false;
+
+    QMetaObject::invokeMethod(this, [this,
+                                     snapshot_size = snapshot ? snapshot->fileSize() : 0,
+                                     migrate = legacy_valid,
+                                     recovered = snapshot && snapshot->isRecovered()]
+    {
+        snapshot_size_ = snapshot_size;
+        migrate_legacy = migrate;
+        truncateHistory();
+        compressHistory();
+        checkpoint();
+
+        // import legacy files once, the snapshot replaces them. persist
+        // recovered manifests, unchanged shards are kept.
+        if ((migrate || recovered) && store_history_)
+            writeSnapshot();
+    }, Qt::QueuedConnection);
+}
+
+void Plugin::writeSnapshot()
+{
+    // one at a time, not while loading, the history is incomplete
+    if (checkpointing || loading)
+        return;
+
+    QDir data_dir = dataLocation();
+    if (!data_dir.exists() && !data_dir.mkpath(u"."_s))
+    {
+        WARN << "Failed creating data dir" << data_dir.path();
+        return;
+    }
+
+    const auto path = data_dir.filePath(SNAPSHOT_FILE_NAME);
+    DEBG << "Writing clipboard history to" << path;
+
+    // off the gui thread. the journal position is read under the lock, i.e.
+    // matches the state written.
+    checkpointing = true;
+    stop_checkpoint = false;
+    checkpointer = async(launch::async, [this, path]
+    {
+        // the view shares the text, i.e. the history is locked for copying
+        // the metadata of the changed months only, not for the I/O
+        const auto previous = Snapshot::previous(path);
+        Journal::Position position;
+        History::View view;
+        {
+            shared_lock lock(mutex);
+            position = journal.position();
+            vector<qint64> changed;
+            for (const auto &month : history.months())
+                if (!previous.keeps(month, history.compressionAge()))
+                    changed.push_back(month.month);
+            view = history.view(changed);
+        }
+        const auto size = Snapshot::write(path, previous, view, position, &stop_checkpoint);
+
+        // the snapshot contains the journaled modifications up to its
+        // position, keep the ones journaled meanwhile
+        const bool discarded = size >= 0 && journal.discard(position);
+
+        QMetaObject::invokeMethod(this, [this, path, size, discarded]
+        {
+            checkpointing = false;
+
+            if (size < 0)
+                WARN << "Failed writing clipboard history to" << path;
+
+            else if (store_history_)
+            {
+                snapshot_size_ = size;
+                if (!discarded)
+                    WARN << "Failed truncating clipboard journal.";
+
+                // malformed legacy files are kept, they were imported partially
+                if (migrate_legacy)
+                {
+                    QFile::remove(QDir(dataLocation()).filePath(LEGACY_FILE_NAME));
+                    migrate_legacy = false;
+                }
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void Plugin::checkpoint(bool idle)
+{
+    // amortized O(1), the journal outgrows the snapshot before rewriting it.
+    // when idle already at an eighth, such that shutdowns and replays are short.
+    if (!store_history_)
+        return;
+
+    if (journal.commitFailed())
+        WARN << "Failed committing clipboard journal.";
+
+    // the first record of a group starts the commit window
+    if (journal.isDirty() && !commit_timer.isActive())
+        commit_timer.start();
+
+    if (!idle)
+        idle_timer.start();
+
+    if (journal.size() > snapshot_size_ + JOURNAL_SLACK
+        || (idle && !journal.isEmpty() && journal.size() > snapshot_size_ / 8))
+        writeSnapshot();
+}
+
+void Plugin::removeEntry(quint64 id)
+{
+#if defined(CLIPBOARD_SQLITE)
+    if (sql)
+    {
+        sql->remove(id);
+        return;
+    }
+#endif
+
+    bool removed;
+    {
+        lock_guard lock(mutex);
+        if ((removed = history.remove(id)) && store_history_)
+            journal.remove(id);
+    }
+    if (removed)
+    {
+        truncateHistory();  // compacts, frees the old generation off the gui thread
+        checkpoint();
     }
 }
 
 ItemGenerator Plugin::items(QueryContext &ctx)
 {
-    vector<shared_ptr<Item>> items;
+#if defined(CLIPBOARD_SQLITE)
+    // indexed, page by page as long as the query is alive
+    if (sql)
+    {
+        const auto query = ctx.query().trimmed();
+        for (size_t offset = 0; ctx.isValid();)
+        {
+            vector<shared_ptr<Item>> items;
+            const auto rows = sql->rows(query, SQLITE_PAGE_SIZE, offset);
+            for (const auto &row : rows)
+                items.push_back(make_shared<ClipboardItem>(*this, (int)++offset, row.id,
+                                                           row.datetime, row.text));
+            if (!items.empty())
+                co_yield items;
+            if (rows.size() < SQLITE_PAGE_SIZE)
+                co_return;
+        }
+        co_return;
+    }
+#endif
+
+    const auto query = ctx.query();
+    Matcher matcher(query, {.fuzzy=fuzzy});
+
+    // queries reach the shards not loaded yet
+    if (loading)
+    {
+        {
+            lock_guard lock(load_mutex);
+            resume_loading = true;
+        }
+        load_cv.notify_one();
+    }
 
+    // the matches of a query extending the last one are among the last
+    // matches unless the history changed meanwhile. fuzzy matches are not,
+    // longer queries tolerate more errors.
+    auto matches = fuzzy || query.isEmpty() ? nullptr : make_shared<Matches>(Matches{query});
+    shared_ptr<const vector<quint64>> candidates;  // ids, most recent first
+    size_t next = 0;  // candidate
+
+    // batch by batch as long as the query is alive, the lock is not held
+    // across yields, i.e. the history may change in between
+    History::Cursor cursor;
+    size_t rank = 0;
+    bool first = true;
+    bool more = true;
+    while (more && ctx.isValid())
     {
-        QLocale loc;
-        int rank = 0;
-        Matcher matcher(ctx.query(), {.fuzzy=fuzzy});
-        shared_lock l(mutex);
+        vector<shared_ptr<Item>> items;
 
-        for (const auto &entry : history)
         {
-            ++rank;
-            if (matcher.match(entry.text))
+            shared_lock l(mutex);
+
+            if (first)
             {
-                static const auto tr_cp = tr("Copy and paste");
-                static const auto tr_c = tr("Copy");
-                static const auto tr_r = tr("Remove");
-
-                vector<Action> actions;
-
-                if(havePasteSupport())
-                    actions.emplace_back(
-                        u"c"_s, tr_cp,
-                        [t=entry.text](){ setClipboardTextAndPaste(t); }
-                    );
-
-                actions.emplace_back(
-                    u"cp"_s, tr_c,
-                    [t=entry.text](){ setClipboardText(t); }
-                );
-
-                actions.emplace_back(
-                    u"r"_s, tr_r,
-                    [this, t=entry.text]()
-                    {
-                        lock_guard lock(mutex);
-                        this->history.remove_if([t](const auto& ce){ return ce.text == t; });
-                    }
-                );
-
-                if (snippets)
-                    actions.emplace_back(
-                        u"s"_s, tr("Save as snippet"),
-                        [this, t=entry.text]()
-                        {
-                            snippets->addSnippet(t);
-                        });
-
-                items.push_back(StandardItem::make(
-                        id(),
-                        entry.text,
-                        u"#%1 %2"_s.arg(rank).arg(loc.toString(entry.datetime, QLocale::LongFormat)),
-                        [] { return Icon::grapheme(u"📋"_s); },
-                        ::move(actions)
-                    )
-                );
+                first = false;
+
+                if (loading)
+                    items.push_back(StandardItem::make(
+                        u"loading"_s,
+                        tr("Loading clipboard history…"),
+                        tr("%1 entries loaded").arg(history.size()),
+                        [] { return Icon::grapheme(u"⏳"_s); }
+                    ));
+
+                {
+                    lock_guard lock(matches_mutex);
+                    if (matches && last_matches
+                        && last_matches->generation == history.generation()
+                        && query.startsWith(last_matches->query))
+                        candidates = {last_matches, &last_matches->ids};
+                    if (matches)
+                        matches->generation = history.generation();
+                }
+
+                // else the entries holding the trigrams of the query, unless
+                // they are a large part of the history anyway
+                if (!candidates && !fuzzy)
+                    if (auto ids = history.candidates(
+                            query, min(CANDIDATE_LIMIT, history.size() / 4)); ids)
+                        candidates = make_shared<const vector<quint64>>(::move(*ids));
             }
+            else if (matches && matches->generation != history.generation())
+                matches.reset();  // incomplete
+
+            auto match = [&](size_t r, const ClipboardEntry &entry, QStringView text)
+            {
+                // match on the arena data in place, items read the text once shown
+                if (matcher.match(QString::fromRawData(text.data(), text.size())))
+                {
+                    if (matches)
+                        matches->ids.push_back(entry.id);
+                    items.push_back(make_shared<ClipboardItem>(*this, (int)r, entry.id,
+                                                               entry.datetime, entry.spilled()));
+                }
+            };
+
+            if (candidates)
+            {
+                const auto count = min(SCAN_BATCH_SIZE, candidates->size() - next);
+                history.forEach(span(*candidates).subspan(next, count), match);
+                next += count;
+                more = next < candidates->size();
+            }
+            else
+                more = history.forEach(cursor, SCAN_BATCH_SIZE,
+                                       [&](const auto &entry, QStringView text)
+                                       { match(++rank, entry, text); });
         }
+
+        if (!items.empty())
+            co_yield items;
     }
 
-    co_yield items;
+    // complete, refined by the next query
+    if (!more && matches)
+    {
+        lock_guard lock(matches_mutex);
+        last_matches = ::move(matches);
+    }
 }
 
 QWidget *Plugin::buildConfigWidget()
@@ -187,6 +549,72 @@ QWidget *Plugin::buildConfigWidget()
     l->addRow(tr("History limit"), s);
     bindWidget(s, this, &Plugin::historyLimit, &Plugin::setHistoryLimit);
 
+    auto *m = new QSpinBox;
+    m->setMinimum(0);
+    m->setMaximum(1'000'000);
+    m->setSuffix(u" MiB"_s);
+    m->setSpecialValueText(tr("Unlimited"));
+    m->setValue(memory_limit_);
+    bindWidget(m, this, &Plugin::memoryLimit, &Plugin::setMemoryLimit);
+
+    auto *usage = new QLabel;
+    auto update_usage = [this, usage]
+    {
+        shared_lock lock(mutex);
+        usage->setText(tr("%1 in use").arg(QLocale().formattedDataSize((qint64)history.memoryUsage())));
+    };
+    update_usage();
+    // connected after the bindings, i.e. shows the usage after truncation
+    connect(s, &QSpinBox::valueChanged, usage, update_usage);
+    connect(m, &QSpinBox::valueChanged, usage, update_usage);
+
+    auto *hl = new QHBoxLayout;
+    hl->addWidget(m);
+    hl->addWidget(usage);
+    l->addRow(tr("Memory limit"), hl);
+
+    auto *t = new QSpinBox;
+    t->setMinimum(0);
+    t->setMaximum(1'000'000);
+    t->setSuffix(u" KiB"_s);
+    t->setSpecialValueText(tr("Never"));
+    t->setValue(spill_threshold_);
+    l->addRow(tr("Spill to disk above"), t);
+    bindWidget(t, this, &Plugin::spillThreshold, &Plugin::setSpillThreshold);
+
+    auto *c = new QSpinBox;
+    c->setMinimum(0);
+    c->setMaximum(10'000);
+    c->setSuffix(tr(" days"));
+    c->setSpecialValueText(tr("Never"));
+    c->setValue(compression_age_);
+    l->addRow(tr("Compress entries older than"), c);
+    bindWidget(c, this, &Plugin::compressionAge, &Plugin::setCompressionAge);
+
+    auto *b = new QSpinBox;
+    b->setMinimum(0);
+    b->setMaximum(60'000);
+    b->setSuffix(u" ms"_s);
+    b->setValue(shutdown_budget_);
+    l->addRow(tr("Shutdown time budget"), b);
+    bindWidget(b, this, &Plugin::shutdownBudget, &Plugin::setShutdownBudget);
+
+#if defined(CLIPBOARD_SQLITE)
+    auto *q = new QCheckBox;
+    q->setChecked(sqlite_);
+    q->setToolTip(tr("Searches the history in an SQLite database, stored on disk "
+                     "only if the history is stored. Matches substrings. "
+                     "Takes effect on restart."));
+    l->addRow(tr("SQLite storage"), q);
+    bindWidget(q, this, &Plugin::sqlite, &Plugin::setSqlite);
+#endif
+
+    auto *y = new QComboBox;
+    y->addItems({tr("Never"), tr("Batched"), tr("Immediately")});
+    y->setCurrentIndex(sync_policy_);
+    l->addRow(tr("Sync to disk"), y);
+    connect(y, &QComboBox::currentIndexChanged, this, &Plugin::setSyncPolicy);
+
     w->setLayout(l);
     return w;
 }
@@ -200,12 +628,93 @@ void Plugin::setHistoryLimit(uint v)
         history_limit_ = v;
         settings()->setValue(CFG_HISTORY_LENGTH, v);
 
+        truncateHistory();
+        checkpoint();
+    }
+}
+
+uint Plugin::memoryLimit() const { return memory_limit_; }
+
+void Plugin::setMemoryLimit(uint v)
+{
+    if (v != memory_limit_)
+    {
+        memory_limit_ = v;
+        settings()->setValue(CFG_MEMORY_LIMIT, v);
+
+        truncateHistory();
+        checkpoint();
+    }
+}
+
+uint Plugin::spillThreshold() const { return spill_threshold_; }
+
+void Plugin::setSpillThreshold(uint v)
+{
+    if (v != spill_threshold_)
+    {
+        spill_threshold_ = v;
+        settings()->setValue(CFG_SPILL_SIZE, v);
+
         lock_guard lock(mutex);
-        if (history_limit_ < history.size())
-            history.resize(history_limit_);
+        history.setSpillThreshold((qint64)spill_threshold_ * 1024);
     }
 }
 
+uint Plugin::compressionAge() const { return compression_age_; }
+
+void Plugin::setCompressionAge(uint v)
+{
+    if (v != compression_age_)
+    {
+        compression_age_ = v;
+        settings()->setValue(CFG_COMPRESS_AGE, v);
+
+        {
+            lock_guard lock(mutex);
+            history.setCompressionAge((qint64)compression_age_ * 24 * 60 * 60);
+        }
+        compressHistory();
+    }
+}
+
+uint Plugin::shutdownBudget() const { return shutdown_budget_; }
+
+void Plugin::setShutdownBudget(uint v)
+{
+    if (v != shutdown_budget_)
+    {
+        shutdown_budget_ = v;
+        settings()->setValue(CFG_SHUTDOWN_TIME, v);
+    }
+}
+
+uint Plugin::syncPolicy() const { return sync_policy_; }
+
+void Plugin::setSyncPolicy(uint v)
+{
+    if (v != sync_policy_)
+    {
+        sync_policy_ = v;
+        settings()->setValue(CFG_SYNC_POLICY, v);
+
+        journal.setSyncPolicy((Journal::SyncPolicy)v);
+    }
+}
+
+#if defined(CLIPBOARD_SQLITE)
+bool Plugin::sqlite() const { return sqlite_; }
+
+void Plugin::setSqlite(bool v)
+{
+    if (v != sqlite_)
+    {
+        sqlite_ = v;
+        settings()->setValue(CFG_SQLITE, v);
+    }
+}
+#endif
+
 bool Plugin::storeHistory() const { return store_history_; }
 
 void Plugin::setStoreHistory(bool v)
@@ -214,6 +723,24 @@ void Plugin::setStoreHistory(bool v)
     {
         store_history_ = v;
         settings()->setValue(CFG_STORE_HISTORY, v);
+
+#if defined(CLIPBOARD_SQLITE)
+        if (sql)  // the database is chosen on restart
+            return;
+#endif
+
+        // off the lock, the journal synchronizes itself and closing syncs
+        if (store_history_)
+        {
+            if (!journal.open())
+                WARN << "Failed opening clipboard journal.";
+            writeSnapshot();
+        }
+        else
+        {
+            stop_checkpoint = true;
+            journal.close();
+        }
     }
 }
 
@@ -226,19 +753,86 @@ void Plugin::checkClipboard()
     else
         clipboard_text = text;
 
-    lock_guard lock(mutex);
+    const auto datetime = QDateTime::currentSecsSinceEpoch();
+
+#if defined(CLIPBOARD_SQLITE)
+    if (sql)
+    {
+        if (!sql->add(clipboard_text, datetime))
+            WARN << "Failed adding clipboard entry to the database.";
+        truncateHistory();
+        return;
+    }
+#endif
+
+    {
+        lock_guard lock(mutex);
 
-    // remove dups
-    history.erase(remove_if(history.begin(), history.end(),
-                            [this](const auto &ce) { return ce.text == clipboard_text; }),
-                  history.end());
+        // add an entry, moves dups to the front
+        const auto id = history.add(clipboard_text, datetime);
 
-    // add an entry
-    history.emplace_front(clipboard_text, QDateTime::currentDateTime());
+        // under the lock, checkpoints read the journal position
+        if (store_history_)
+            journal.add(id, datetime, clipboard_text);
+    }
 
     // adjust lenght
-    if (history_limit_ < history.size())
-        history.resize(history_limit_);
+    truncateHistory();
+
+    compressHistory();
+
+    checkpoint();
+}
+
+void Plugin::truncateHistory()
+{
+#if defined(CLIPBOARD_SQLITE)
+    if (sql)
+    {
+        sql->truncate(history_limit_);
+        return;
+    }
+#endif
+
+    unique_ptr<History::Detached> detached;
+    {
+        lock_guard lock(mutex);
+        const auto size = history.size();
+        detached = history.truncate(history_limit_, memoryLimitBytes(memory_limit_));
+
+        // under the lock, checkpoints read the journal position
+        if (store_history_ && history.size() < size)
+            journal.truncate(history.size());
+    }
+
+    // free dropped entries off the lock and the gui thread
+    if (detached)
+    {
+        if (reclaimer.valid())
+            reclaimer.wait();
+        reclaimer = async(launch::async, [d = ::move(detached)]() mutable { d.reset(); });
+    }
+}
+
+void Plugin::compressHistory()
+{
+    // one at a time, the chunks are compressed off the lock and the gui thread
+    if (compressor.valid() && compressor.wait_for(0s) != future_status::ready)
+        return;
+
+    vector<TextArena::Frozen> chunks;
+    {
+        shared_lock lock(mutex);
+        chunks = history.freezable();
+    }
+
+    if (!chunks.empty())
+        compressor = async(launch::async, [this, chunks = ::move(chunks)]() mutable
+        {
+            TextArena::compress(chunks);
+            lock_guard lock(mutex);
+            history.freeze(chunks);
+        });
 }
 
 bool Plugin::supportsFuzzyMatching() const { return true; }
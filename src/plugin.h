@@ -1,31 +1,30 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "history.h"
+#include "journal.h"
+#if defined(CLIPBOARD_SQLITE)
+#include "sqlhistory.h"
+#endif
 #include <QClipboard>
-#include <QDateTime>
 #include <QTimer>
 #include <albert/extensionplugin.h>
 #include <albert/plugin/snippets.h>
 #include <albert/plugindependency.h>
 #include <albert/generatorqueryhandler.h>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 #include <shared_mutex>
-
-
-struct ClipboardEntry
-{
-    // required to allow list<ClipboardEntry>::resize
-    // actually never used.
-    ClipboardEntry() = default;
-    ClipboardEntry(QString t, QDateTime dt) : text(std::move(t)), datetime(dt) {}
-    QString text;
-    QDateTime datetime;
-};
+#include <vector>
 
 
 class Plugin : public albert::ExtensionPlugin,
                public albert::GeneratorQueryHandler
 {
     ALBERT_PLUGIN
+    friend class ClipboardItem;
 
 public:
 
@@ -40,21 +39,80 @@ public:
     uint historyLimit() const;
     void setHistoryLimit(uint);
 
+    uint memoryLimit() const;  // MiB
+    void setMemoryLimit(uint);
+
+    uint spillThreshold() const;  // KiB
+    void setSpillThreshold(uint);
+
+    uint compressionAge() const;  // days
+    void setCompressionAge(uint);
+
+    uint shutdownBudget() const;  // ms
+    void setShutdownBudget(uint);
+
+    uint syncPolicy() const;  // Journal::SyncPolicy
+    void setSyncPolicy(uint);
+
     bool storeHistory() const;
     void setStoreHistory(bool);
 
+#if defined(CLIPBOARD_SQLITE)
+    bool sqlite() const;  // effective on restart
+    void setSqlite(bool);
+#endif
+
 private:
+    void removeEntry(quint64 id);
     void checkClipboard();
+    void truncateHistory();
+    void compressHistory();
+    void loadHistory(size_t limit, size_t bytes);
+    void writeSnapshot();
+    void checkpoint(bool idle = false);
 
     QTimer timer;
+    QTimer idle_timer;
+    QTimer commit_timer;
     QClipboard * const clipboard;
     uint history_limit_;
-    std::list<ClipboardEntry> history;
+    uint memory_limit_;
+    uint spill_threshold_;
+    uint compression_age_;
+    uint shutdown_budget_;
+    uint sync_policy_;
+    History history;
+    Journal journal;
+    qint64 snapshot_size_ = 0;
     bool store_history_;
     bool fuzzy;
     std::shared_mutex mutex;
     // explicit current, such that users can delete recent ones
     QString clipboard_text;
+    std::future<void> reclaimer;
+    std::future<void> compressor;
+    std::future<void> loader;
+    std::atomic_bool loading = false;
+    std::atomic_bool stop_loading = false;
+    std::mutex load_mutex;
+    std::condition_variable load_cv;
+    bool resume_loading = false;  // guarded by load_mutex
+    struct Matches
+    {
+        QString query;
+        quint64 generation = 0;  // of the history
+        std::vector<quint64> ids;  // most recent first
+    };
+    std::mutex matches_mutex;
+    std::shared_ptr<const Matches> last_matches;  // guarded by matches_mutex
+    std::future<void> checkpointer;
+    std::atomic_bool stop_checkpoint = false;
+    bool checkpointing = false;
+    bool migrate_legacy = false;  // remove the legacy file once snapshotted
+#if defined(CLIPBOARD_SQLITE)
+    bool sqlite_;
+    std::unique_ptr<SqlHistory> sql;
+#endif
     
     albert::WeakDependency<snippets::Plugin> snippets{QStringLiteral("snippets")};
 };
@@ -0,0 +1,874 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "crc32c.h"
+#include "dictionary.h"
+#include "history.h"
+#include "snapshot.h"
+#include "trigramindex.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+namespace {
+
+constexpr quint32 magic = 0x434c5053;  // CLPS
+constexpr quint32 index_magic = 0x434c5049;  // CLPI
+constexpr quint32 version = 6;
+
+constexpr quint32 compressed = 1;  // flag
+// 8 KiB, a preset dictionary helps within the 32 KiB deflate window only
+constexpr qsizetype block_capacity = 4 * 1024;  // code units
+constexpr qsizetype sample_size = 256 * 1024;  // bytes of text to train on
+constexpr qsizetype sample_entry_size = 4 * 1024;
+
+// detects files written with a different hash function
+const auto hash_probe = u"albert clipboard"_s;
+
+struct Manifest
+{
+    quint32 magic;
+    quint32 version;
+    quint64 count;  // of shards
+    quint64 probe;  // hash of hash_probe
+    quint64 next_id;
+    quint64 journal_generation;
+    quint64 journal_offset;
+    quint64 generation;  // of the last write
+    quint32 crc;  // of the manifest and the shard list
+    quint32 reserved;
+};
+
+struct Shard
+{
+    qint64 month;  // months since year 0, UTC
+    quint64 generation;  // of the write creating the file
+    quint64 count;  // of entries
+    quint64 digest;  // of ids and timestamps, detects changes
+    quint64 size;  // of the file in bytes
+    quint64 flags;
+};
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint64 count;
+    quint64 table;  // offset of the rows in bytes
+    quint32 crc;  // of the header
+    quint32 flags;
+    quint64 dictionary;  // offset in bytes, if compressed
+    quint64 dictionary_size;
+    quint64 blocks;  // offset of the block table in bytes, if compressed
+    quint64 block_count;
+};
+
+// compressed text, entries do not span blocks
+struct Block
+{
+    quint64 offset;  // in bytes
+    quint64 size;  // compressed, in bytes
+    quint32 length;  // in UTF-16 code units
+    quint32 crc;  // of the compressed data
+};
+
+struct Row
+{
+    quint64 id;
+    qint64 datetime;
+    quint64 hash;
+    quint64 offset;  // of the text in bytes, in code units in the block if compressed
+    quint64 length;  // of the text in UTF-16 code units
+    quint32 crc;  // of the text and the row, of the row only if compressed
+    quint32 block;  // if compressed
+};
+
+// the trigram index of the text of a shard, at the end of the file, following
+// the rows. shards without one are indexed when read.
+struct Index
+{
+    quint32 magic;
+    quint32 crc;  // of the trigrams, the postings and the index
+    quint64 trigrams;  // offset in bytes
+    quint64 trigram_count;
+    quint64 postings;  // offset in bytes
+    quint64 posting_count;
+};
+
+struct Trigram
+{
+    quint64 key;
+    quint64 count;  // of postings
+};
+
+qsizetype align(qsizetype offset) { return (offset + 7) / 8 * 8; }
+
+// checksum of a struct with a crc field, excluding the field
+template<class T>
+quint32 checksum(T t, quint32 crc = 0)
+{
+    t.crc = 0;
+    return crc32c(&t, sizeof(T), crc);
+}
+
+struct Mapping
+{
+    QFile file;
+    uchar *data = nullptr;
+    ~Mapping() { if (data) file.unmap(data); }
+};
+
+bool isValid(const Header &header, quint64 size)
+{
+    return header.magic == magic
+           && header.version == version
+           && header.crc == checksum(header)
+           && header.table % alignof(Row) == 0
+           && header.table >= sizeof(Header)
+           && header.table <= size
+           && (size - header.table) / sizeof(Row) >= header.count;
+}
+
+QString shardPath(const QString &path, const Shard &shard)
+{
+    return u"%1.%2-%3.%4"_s.arg(path)
+        .arg(shard.month / 12, 4, 10, u'0')
+        .arg(shard.month % 12 + 1, 2, 10, u'0')
+        .arg(shard.generation);
+}
+
+bool readManifest(const QString &path, Manifest &manifest, vector<Shard> &shards)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)
+        || file.read(reinterpret_cast<char*>(&manifest), sizeof(Manifest)) != sizeof(Manifest)
+        || manifest.magic != magic
+        || manifest.version != version
+        || manifest.count > (quint64)(file.size() - (qint64)sizeof(Manifest)) / sizeof(Shard))
+        return false;
+
+    shards.resize(manifest.count);
+    const auto bytes = (qint64)(shards.size() * sizeof(Shard));
+    return file.read(reinterpret_cast<char*>(shards.data()), bytes) == bytes
+           && manifest.crc == crc32c(shards.data(), (size_t)bytes, checksum(manifest));
+}
+
+// rebuilds the manifest from the shard files, the month and the generation are
+// in their names and their headers and rows are self-checking. the newest file
+// of a month wins. the hashes are not trusted, the journal is replayed entirely.
+bool recoverManifest(const QString &path, Manifest &manifest, vector<Shard> &shards)
+{
+    static const QRegularExpression pattern(uR"(^\.(\d{4})-(\d{2})\.(\d+)$)"_s);
+    const QFileInfo info(path);
+    map<qint64, Shard, greater<>> found;
+    quint64 next_id = 0;
+    quint64 generation = 0;
+
+    for (const auto &file_info : info.dir().entryInfoList({info.fileName() + u".*"_s}, QDir::Files))
+    {
+        const auto match = pattern.match(file_info.fileName().sliced(info.fileName().size()));
+        if (!match.hasMatch())
+            continue;
+
+        Shard shard{match.capturedView(1).toLongLong() * 12 + match.capturedView(2).toLongLong() - 1,
+                    match.capturedView(3).toULongLong(), 0, 0, (quint64)file_info.size(), 0};
+        generation = max(generation, shard.generation);  // new files must not collide
+
+        Mapping mapping;
+        mapping.file.setFileName(file_info.filePath());
+        if (!mapping.file.open(QIODevice::ReadOnly)
+            || shard.size < sizeof(Header)
+            || !(mapping.data = mapping.file.map(0, (qint64)shard.size)))
+            continue;
+
+        const auto &header = *reinterpret_cast<const Header*>(mapping.data);
+        if (!isValid(header, shard.size))
+            continue;
+
+        // ids of intact rows only, captures while loading must not reuse them
+        const auto rows = reinterpret_cast<const Row*>(mapping.data + header.table);
+        const auto text = mapping.data + sizeof(Header);
+        for (quint64 i = 0; i < header.count; ++i)
+        {
+            const auto &row = rows[i];
+            if (header.flags & compressed
+                    ? row.crc == checksum(row)
+                    : row.offset >= sizeof(Header)
+                      && row.offset <= header.table
+                      && row.length <= (header.table - row.offset) / sizeof(char16_t)
+                      && row.crc == checksum(row, crc32c(text + row.offset - sizeof(Header),
+                                                         row.length * sizeof(char16_t))))
+                next_id = max(next_id, row.id + 1);
+        }
+
+        shard.count = header.count;
+        shard.flags = header.flags & compressed;
+        if (auto it = found.find(shard.month);
+            it == found.end() || it->second.generation < shard.generation)
+            found[shard.month] = shard;
+    }
+
+    if (found.empty())
+        return false;
+
+    manifest = {magic, version, found.size(), 0, next_id, 0, 0, generation, 0, 0};
+    shards.clear();
+    for (const auto &[m, shard] : found)
+        shards.push_back(shard);
+    return true;
+}
+
+// writes _index_, whose ids are row numbers, at _offset_ and the end of _file_
+bool writeIndex(QSaveFile &file, qint64 offset, const TrigramIndex &index)
+{
+    vector<Trigram> trigrams;
+    vector<quint32> postings;
+    index.forEach([&](quint64 key, span<const quint32> rows)
+    {
+        trigrams.push_back({key, rows.size()});
+        postings.insert(postings.end(), rows.begin(), rows.end());
+    });
+
+    const auto trigram_bytes = (qint64)(trigrams.size() * sizeof(Trigram));
+    const auto posting_bytes = (qint64)(postings.size() * sizeof(quint32));
+    Index trailer{index_magic, 0, (quint64)align(offset), trigrams.size(),
+                  (quint64)align(offset) + (quint64)trigram_bytes, postings.size()};
+    trailer.crc = checksum(trailer, crc32c(postings.data(), (size_t)posting_bytes,
+                                           crc32c(trigrams.data(), (size_t)trigram_bytes)));
+
+    return file.seek(align(offset))
+           && file.write(reinterpret_cast<const char*>(trigrams.data()), trigram_bytes)
+                  == trigram_bytes
+           && file.write(reinterpret_cast<const char*>(postings.data()), posting_bytes)
+                  == posting_bytes
+           && file.seek(align(file.pos()))
+           && file.write(reinterpret_cast<const char*>(&trailer), sizeof(Index)) == sizeof(Index);
+}
+
+qint64 writeShard(const QString &path, const History::View &history, qint64 shard_month,
+                  const atomic_bool *cancel)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return -1;
+
+    Header header{magic, version, 0, 0, 0, 0, 0, 0, 0, 0};
+    vector<Row> rows;
+    TrigramIndex index;  // of the full text, by row
+
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(Header)) == sizeof(Header);
+
+    history.forEach(shard_month, [&](const ClipboardEntry &entry, QStringView resident)
+    {
+        if (cancel && *cancel)
+            return ok = false;
+
+        QString spilled;
+        const auto text = entry.spilled() ? QStringView(spilled = history.text(entry)) : resident;
+        const auto bytes = text.size() * (qint64)sizeof(char16_t);
+
+        Row row{entry.id, entry.datetime, entry.hash, (quint64)file.pos(),
+                (quint64)text.size(), 0, 0};
+        row.crc = checksum(row, crc32c(text.utf16(), (size_t)bytes));
+        index.add(rows.size(), text);
+        rows.push_back(row);
+        return ok = file.write(reinterpret_cast<const char*>(text.utf16()), bytes) == bytes;
+    });
+
+    // align the table
+    header.count = rows.size();
+    header.table = align(file.pos());
+    header.crc = checksum(header);
+    const auto table_bytes = (qint64)(rows.size() * sizeof(Row));
+
+    ok = ok
+         && file.seek(header.table)
+         && file.write(reinterpret_cast<const char*>(rows.data()), table_bytes) == table_bytes
+         && writeIndex(file, header.table + table_bytes, index)
+         && file.seek(0)
+         && file.write(reinterpret_cast<const char*>(&header), sizeof(Header)) == sizeof(Header);
+
+    const auto size = file.size();
+    return ok && file.commit() ? size : -1;
+}
+
+qint64 writeCompressedShard(const QString &path, const History::View &history,
+                            qint64 shard_month, const atomic_bool *cancel)
+{
+    // train on the resident text of the most recent entries
+    QByteArray sample;
+    vector<pair<qsizetype, qsizetype>> sample_entries;
+    history.forEach(shard_month, [&](const ClipboardEntry &, QStringView text)
+    {
+        const auto bytes = QByteArrayView(reinterpret_cast<const char*>(text.utf16()),
+                                          text.size() * (qsizetype)sizeof(char16_t));
+        sample_entries.emplace_back(sample.size(), min(bytes.size(), sample_entry_size));
+        sample.append(bytes.first(sample_entries.back().second));
+        return sample.size() < sample_size;
+    });
+
+    vector<QByteArrayView> samples;
+    for (const auto &[offset, size] : sample_entries)
+        samples.push_back(QByteArrayView(sample).sliced(offset, size));
+    const auto dictionary = trainDictionary(samples);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return -1;
+
+    Header header{magic, version, 0, 0, 0, compressed,
+                  sizeof(Header), (quint64)dictionary.size(), 0, 0};
+    vector<Block> blocks;
+    vector<Row> rows;
+    TrigramIndex index;  // of the full text, by row
+    QByteArray block;
+
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(Header)) == sizeof(Header)
+              && file.write(dictionary) == dictionary.size();
+
+    auto flush = [&]
+    {
+        if (!ok || block.isEmpty())
+            return;
+        const auto data = dictionaryCompress(block, dictionary);
+        blocks.push_back({(quint64)file.pos(), (quint64)data.size(),
+                          (quint32)(block.size() / (qsizetype)sizeof(char16_t)),
+                          crc32c(data.constData(), (size_t)data.size())});
+        ok = !data.isNull() && file.write(data) == data.size();
+        block.clear();
+    };
+
+    history.forEach(shard_month, [&](const ClipboardEntry &entry, QStringView resident)
+    {
+        if (cancel && *cancel)
+            return ok = false;
+
+        QString spilled;
+        const auto text = entry.spilled() ? QStringView(spilled = history.text(entry)) : resident;
+
+        if (block.size() / (qsizetype)sizeof(char16_t) + text.size() > block_capacity)
+            flush();
+
+        Row row{entry.id, entry.datetime, entry.hash,
+                (quint64)(block.size() / (qsizetype)sizeof(char16_t)),
+                (quint64)text.size(), 0, (quint32)blocks.size()};
+        row.crc = checksum(row);
+        index.add(rows.size(), text);
+        rows.push_back(row);
+        block.append(reinterpret_cast<const char*>(text.utf16()),
+                     text.size() * (qsizetype)sizeof(char16_t));
+        return ok;
+    });
+    flush();
+
+    header.blocks = align(file.pos());
+    header.block_count = blocks.size();
+    const auto block_bytes = (qint64)(blocks.size() * sizeof(Block));
+    header.count = rows.size();
+    header.table = align(header.blocks + block_bytes);
+    header.crc = checksum(header);
+    const auto table_bytes = (qint64)(rows.size() * sizeof(Row));
+
+    ok = ok
+         && file.seek(header.blocks)
+         && file.write(reinterpret_cast<const char*>(blocks.data()), block_bytes) == block_bytes
+         && file.seek(header.table)
+         && file.write(reinterpret_cast<const char*>(rows.data()), table_bytes) == table_bytes
+         && writeIndex(file, header.table + table_bytes, index)
+         && file.seek(0)
+         && file.write(reinterpret_cast<const char*>(&header), sizeof(Header)) == sizeof(Header);
+
+    const auto size = file.size();
+    return ok && file.commit() ? size : -1;
+}
+
+// shards of old entries only are compressed, i.e. are rarely rewritten
+quint64 shardFlags(const History::Month &month, qint64 compression_age, qint64 now)
+{ return compression_age > 0 && month.newest < now - compression_age ? compressed : 0; }
+
+}
+
+struct Snapshot::Private
+{
+    Manifest manifest;
+    vector<Shard> shards;
+    QString path;
+    size_t shard = 0;  // the current one
+    bool recovered = false;
+
+    // the current shard, mapped when reached
+    shared_ptr<Mapping> mapping;
+    const Header *header;
+    const Row *rows;
+    const char16_t *text;
+    bool in_place;
+    bool indexed;  // the postings of the shard have been added
+    quint64 index_generation;  // of the history when they were added
+    vector<quint32> row_postings;  // added per row
+    bool chunk_added;
+    quint32 chunk;
+    quint64 next;
+    size_t damaged = 0;
+
+    // the current shard, if compressed
+    const Block *blocks;
+    shared_ptr<const QByteArray> dictionary;
+    vector<optional<quint32>> block_chunks;  // added ones
+    vector<bool> damaged_blocks;
+    QString inflated;  // the last block, if not in place
+    quint64 inflated_block;
+
+    bool openShard();
+    void readIndex(History &history);
+    bool isIndexed(const History &history) const;
+    void discardIndex(History &history, quint64 first, quint64 last);
+    bool openBlock(History &history, quint32 block);
+    void readText(History &history, size_t &count, const unordered_set<quint64> &removed,
+                  TextArena::Cache &cache);
+    void readBlocks(History &history, size_t &count, const unordered_set<quint64> &removed,
+                    TextArena::Cache &cache);
+};
+
+bool Snapshot::Private::openShard()
+{
+    mapping = make_shared<Mapping>();
+    mapping->file.setFileName(shardPath(path, shards[shard]));
+    if (!mapping->file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto size = (quint64)mapping->file.size();
+    if (size < sizeof(Header) || !(mapping->data = mapping->file.map(0, size)))
+        return false;
+
+    header = reinterpret_cast<const Header*>(mapping->data);
+    if (!isValid(*header, size))
+        return false;
+
+    rows = reinterpret_cast<const Row*>(mapping->data + header->table);
+    text = reinterpret_cast<const char16_t*>(mapping->data + sizeof(Header));
+    chunk_added = false;
+    next = 0;
+
+    if (header->flags & compressed)
+    {
+        if (header->dictionary > size
+            || header->dictionary_size > size - header->dictionary
+            || header->blocks % alignof(Block)
+            || header->blocks > size
+            || (size - header->blocks) / sizeof(Block) < header->block_count)
+            return false;
+
+        blocks = reinterpret_cast<const Block*>(mapping->data + header->blocks);
+        dictionary = make_shared<const QByteArray>(
+            reinterpret_cast<const char*>(mapping->data + header->dictionary),
+            (qsizetype)header->dictionary_size);
+        block_chunks.assign(header->block_count, nullopt);
+        damaged_blocks.assign(header->block_count, false);
+        inflated_block = header->block_count;
+
+        // blocks are copied, the hashes decide
+        in_place = manifest.probe == History::hash(hash_probe);
+        return true;
+    }
+
+    // in place if the hashes match and the offsets fit the arena
+    in_place = manifest.probe == History::hash(hash_probe)
+               && (header->table - sizeof(Header)) / sizeof(char16_t)
+                      <= numeric_limits<quint32>::max();
+    return true;
+}
+
+void Snapshot::Private::readIndex(History &history)
+{
+    indexed = false;
+
+    // at the end of the file, shards written before have none
+    const auto size = (quint64)mapping->file.size();
+    if (size < header->table + sizeof(Index) || (size - sizeof(Index)) % alignof(Index))
+        return;
+
+    const auto end = size - sizeof(Index);
+    const auto &index = *reinterpret_cast<const Index*>(mapping->data + end);
+    if (index.magic != index_magic
+        || index.trigrams % alignof(Trigram)
+        || index.trigrams > end
+        || (end - index.trigrams) / sizeof(Trigram) < index.trigram_count
+        || index.postings % alignof(quint32)
+        || index.postings > end
+        || (end - index.postings) / sizeof(quint32) < index.posting_count)
+        return;
+
+    const auto trigrams = reinterpret_cast<const Trigram*>(mapping->data + index.trigrams);
+    const auto postings = reinterpret_cast<const quint32*>(mapping->data + index.postings);
+    if (index.crc != checksum(index, crc32c(postings, index.posting_count * sizeof(quint32),
+                                            crc32c(trigrams, index.trigram_count
+                                                                 * sizeof(Trigram)))))
+        return;
+
+    // the postings are row numbers. rows are verified when read, i.e. damaged
+    // ones leave stale postings.
+    vector<quint64> ids;
+    row_postings.assign(header->count, 0);
+    for (quint64 i = 0, offset = 0; i < index.trigram_count; ++i)
+    {
+        const auto count = min(trigrams[i].count, index.posting_count - offset);
+        ids.clear();
+        for (const auto row : span(postings + offset, count))
+            if (row < header->count && rows[row].id < manifest.next_id)
+            {
+                ids.push_back(rows[row].id);
+                ++row_postings[row];
+            }
+        history.addIndex(trigrams[i].key, ids);
+        offset += count;
+    }
+
+    indexed = true;
+    index_generation = history.indexGeneration();
+}
+
+bool Snapshot::Private::isIndexed(const History &history) const
+{ return indexed && index_generation == history.indexGeneration(); }
+
+// the postings of skipped rows, i.e. damaged, removed or duplicate ones, and
+// of rows not read otherwise overstate the memory usage
+void Snapshot::Private::discardIndex(History &history, quint64 first, quint64 last)
+{
+    if (!isIndexed(history))
+        return;
+    quint64 count = 0;
+    for (auto row = first; row < last; ++row)
+        count += row_postings[row];
+    history.discardIndex(count);
+}
+
+bool Snapshot::Private::openBlock(History &history, quint32 index)
+{
+    if (damaged_blocks[index])
+        return false;
+
+    const auto &block = blocks[index];
+    const auto size = (quint64)mapping->file.size();
+    const auto data = reinterpret_cast<const char*>(mapping->data + block.offset);
+    if (block.offset > size
+        || block.size > size - block.offset
+        || block.crc != crc32c(data, block.size))
+    {
+        damaged_blocks[index] = true;
+        return false;
+    }
+
+    if (in_place)
+    {
+        if (!block_chunks[index])
+            block_chunks[index] = history.addCompressedText(QByteArray(data, (qsizetype)block.size),
+                                                            block.length, dictionary);
+    }
+    else if (inflated_block != index)
+    {
+        inflated.resize(block.length);
+        if (!dictionaryDecompress({data, (qsizetype)block.size}, *dictionary,
+                                  reinterpret_cast<char*>(inflated.data()),
+                                  block.length * (qsizetype)sizeof(char16_t)))
+        {
+            damaged_blocks[index] = true;
+            return false;
+        }
+        inflated_block = index;
+    }
+    return true;
+}
+
+void Snapshot::Private::readText(History &history, size_t &count,
+                                 const unordered_set<quint64> &removed, TextArena::Cache &cache)
+{
+    const auto table = header->table;
+    const bool indexed = isIndexed(history);
+
+    if (in_place && !chunk_added)
+    {
+        const auto text_length = (table - sizeof(Header)) / sizeof(char16_t);
+        chunk = history.addExternalText(QStringView(text, (qsizetype)text_length), mapping);
+        chunk_added = true;
+    }
+
+    for (; count && next < header->count; ++next, --count)
+    {
+        const auto &row = rows[next];
+        if (row.offset < sizeof(Header)
+            || row.offset > table
+            || row.offset % sizeof(char16_t)
+            || row.length > (table - row.offset) / sizeof(char16_t))
+        {
+            ++damaged;
+            discardIndex(history, next, next + 1);
+            continue;
+        }
+        else if (removed.contains(row.id))
+        {
+            discardIndex(history, next, next + 1);
+            continue;
+        }
+
+        const auto offset = (row.offset - sizeof(Header)) / sizeof(char16_t);
+
+        // verified row by row, a damaged entry does not affect the others
+        if (row.crc != checksum(row, crc32c(text + offset, row.length * sizeof(char16_t))))
+        {
+            ++damaged;
+            discardIndex(history, next, next + 1);
+            continue;
+        }
+
+        const auto size = history.size();
+        if (in_place)
+            history.addOldest(chunk, (quint32)offset, (quint32)row.length,
+                              row.datetime, row.id, row.hash, cache, indexed);
+        else  // copies
+            history.addOldest(QStringView(text + offset, (qsizetype)row.length),
+                              row.datetime, row.id, indexed);
+        if (history.size() == size)  // a duplicate
+            discardIndex(history, next, next + 1);
+    }
+}
+
+void Snapshot::Private::readBlocks(History &history, size_t &count,
+                                   const unordered_set<quint64> &removed, TextArena::Cache &cache)
+{
+    const bool indexed = isIndexed(history);
+    for (; count && next < header->count; ++next, --count)
+    {
+        const auto &row = rows[next];
+        if (row.block >= header->block_count
+            || row.offset > blocks[row.block].length
+            || row.length > blocks[row.block].length - row.offset
+            || row.crc != checksum(row))
+        {
+            ++damaged;
+            discardIndex(history, next, next + 1);
+            continue;
+        }
+        else if (removed.contains(row.id))
+        {
+            discardIndex(history, next, next + 1);
+            continue;
+        }
+
+        // verified block by block, a damaged block does not affect the others
+        if (!openBlock(history, row.block))
+        {
+            ++damaged;
+            discardIndex(history, next, next + 1);
+            continue;
+        }
+
+        const auto size = history.size();
+        if (in_place)
+            history.addOldest(*block_chunks[row.block], (quint32)row.offset, (quint32)row.length,
+                              row.datetime, row.id, row.hash, cache, indexed);
+        else  // copies
+            history.addOldest(QStringView(inflated).sliced((qsizetype)row.offset,
+                                                           (qsizetype)row.length),
+                              row.datetime, row.id, indexed);
+        if (history.size() == size)  // a duplicate
+            discardIndex(history, next, next + 1);
+    }
+}
+
+Snapshot::Snapshot() : d(make_unique<Private>()) {}
+
+Snapshot::~Snapshot() = default;
+
+struct Snapshot::Previous::Data
+{
+    Manifest manifest{};
+    vector<Shard> shards;  // existing ones
+    bool intact = false;  // the manifest has been read, not recovered
+    qint64 now = 0;  // compression ages are relative to
+};
+
+bool Snapshot::Previous::keeps(const History::Month &month, qint64 compression_age) const
+{
+    const auto flags = shardFlags(month, compression_age, d->now);
+    const auto it = ranges::find(d->shards, month.month, &Shard::month);
+    return it != d->shards.end() && it->count == month.count && it->digest == month.digest
+           && (it->flags & compressed || !(flags & compressed));
+}
+
+Snapshot::Previous Snapshot::previous(const QString &path)
+{
+    // shards of a different hash function have stale hashes
+    // an unreadable manifest has been recovered on open, i.e. the shards it
+    // missed are kept, however new files must not replace existing ones
+    auto d = make_shared<Previous::Data>();
+    d->intact = readManifest(path, d->manifest, d->shards);
+    if (!d->intact && !recoverManifest(path, d->manifest, d->shards))
+        d->manifest.generation = 0;
+    if (d->manifest.generation == 0 || d->manifest.probe != History::hash(hash_probe))
+        d->shards.clear();
+    erase_if(d->shards, [&](const Shard &shard){ return !QFile::exists(shardPath(path, shard)); });
+    d->now = QDateTime::currentSecsSinceEpoch();
+
+    Previous previous;
+    previous.d = ::move(d);
+    return previous;
+}
+
+qint64 Snapshot::write(const QString &path, const Previous &previous,
+                       const History::View &history, Journal::Position journal,
+                       const atomic_bool *cancel)
+{
+    // partitioned by the view, the text is touched for changed shards only
+    const auto age = history.compressionAge();
+    const auto &old_shards = previous.d->shards;
+    const bool intact = previous.d->intact;
+    auto manifest = Manifest{magic, version, history.months().size(), History::hash(hash_probe),
+                             history.nextId(), journal.generation, (quint64)journal.offset,
+                             previous.d->manifest.generation + 1, 0, 0};
+
+    // unchanged shards are kept, new files get new names, i.e. the current
+    // snapshot stays intact until the manifest is replaced
+    qint64 size = 0;
+    vector<Shard> new_shards;
+    for (const auto &month : history.months())
+    {
+        if (cancel && *cancel)
+            return -1;
+
+        Shard shard{month.month, 0, month.count, month.digest, 0,
+                    shardFlags(month, age, previous.d->now)};
+        if (previous.keeps(month, age))
+        {
+            const auto &old = *ranges::find(old_shards, month.month, &Shard::month);
+            shard.generation = old.generation;
+            shard.size = old.size;
+            shard.flags = old.flags;
+        }
+        else if (!history.contains(month.month))
+            return -1;
+        else
+        {
+            shard.generation = manifest.generation;
+            const auto shard_size = shard.flags & compressed
+                ? writeCompressedShard(shardPath(path, shard), history, shard.month, cancel)
+                : writeShard(shardPath(path, shard), history, shard.month, cancel);
+            if (shard_size < 0)
+                return -1;
+            shard.size = (quint64)shard_size;
+        }
+
+        size += (qint64)shard.size;
+        new_shards.push_back(shard);
+    }
+
+    QSaveFile file(path);
+    const auto bytes = (qint64)(new_shards.size() * sizeof(Shard));
+    manifest.crc = crc32c(new_shards.data(), (size_t)bytes, checksum(manifest));
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(reinterpret_cast<const char*>(&manifest), sizeof(Manifest)) != sizeof(Manifest)
+        || file.write(reinterpret_cast<const char*>(new_shards.data()), bytes) != bytes
+        || !file.commit())
+        return -1;
+
+    // replaced and expired shards. mapped ones stay readable until unmapped.
+    // none if the previous manifest was unreadable, they may be all there is.
+    if (!intact)
+        return size + (qint64)sizeof(Manifest) + bytes;
+
+    const QFileInfo info(path);
+    auto dir = info.dir();
+    for (const auto &name : dir.entryList({info.fileName() + u".*"_s}, QDir::Files))
+        if (ranges::none_of(new_shards, [&](const auto &shard)
+                            { return QFileInfo(shardPath(path, shard)).fileName() == name; }))
+            dir.remove(name);
+
+    return size + (qint64)sizeof(Manifest) + bytes;
+}
+
+unique_ptr<Snapshot> Snapshot::open(const QString &path)
+{
+    unique_ptr<Snapshot> snapshot(new Snapshot);
+    auto &d = *snapshot->d;
+    if (!readManifest(path, d.manifest, d.shards)
+        && !(d.recovered = recoverManifest(path, d.manifest, d.shards)))
+        return {};
+    d.path = path;
+    return snapshot;
+}
+
+qint64 Snapshot::fileSize() const
+{
+    qint64 size = sizeof(Manifest) + d->shards.size() * sizeof(Shard);
+    for (const auto &shard : d->shards)
+        size += (qint64)shard.size;
+    return size;
+}
+
+bool Snapshot::isRecovered() const { return d->recovered; }
+
+quint64 Snapshot::nextId() const { return d->manifest.next_id; }
+
+Journal::Position Snapshot::journalPosition() const
+{ return {d->manifest.journal_generation, (qint64)d->manifest.journal_offset}; }
+
+size_t Snapshot::shardsRead() const { return d->shard; }
+
+bool Snapshot::atEnd() const { return d->shard == d->shards.size(); }
+
+size_t Snapshot::damaged() const { return d->damaged; }
+
+void Snapshot::close(History &history)
+{
+    if (d->mapping)
+        d->discardIndex(history, d->next, d->header->count);
+    d->mapping.reset();
+    d->dictionary.reset();
+    d->inflated = {};
+    d->row_postings = {};
+}
+
+void Snapshot::read(History &history, size_t count, const unordered_set<quint64> &removed)
+{
+    history.reserveIds(d->manifest.next_id);
+
+    // per batch, the chunks are renumbered by compactions in between
+    TextArena::Cache cache;
+    while (count && !atEnd())
+    {
+        // skip damaged shards, the others are independent
+        if (!d->mapping)
+        {
+            if (!d->openShard())
+            {
+                d->mapping.reset();
+                d->damaged += d->shards[d->shard].count;
+                ++d->shard;
+                continue;
+            }
+            d->readIndex(history);
+        }
+
+        if (d->header->flags & compressed)
+            d->readBlocks(history, count, removed, cache);
+        else
+            d->readText(history, count, removed, cache);
+
+        // the arena keeps the mapping alive if the text is used in place
+        if (d->next == d->header->count)
+        {
+            d->mapping.reset();
+            d->dictionary.reset();
+            d->inflated = {};
+            ++d->shard;
+            break;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include "history.h"
+#include "journal.h"
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+
+
+///
+/// Binary history snapshot, partitioned by month.
+///
+/// A small manifest lists the shards, most recent first, and holds what
+/// applies to all of them. Each shard is a file holding a header, the UTF-16
+/// text of the entries captured in that month and a table of fixed size rows
+/// holding id, timestamp, hash, offset and length of each entry, most recent
+/// first. Reading maps the shards one by one when they are reached and uses
+/// the text in place, i.e. loading touches the tables only and the text is
+/// paged in when it is used.
+///
+/// Writing rewrites the shards that changed only and commits them by
+/// replacing the manifest. Expired shards are deleted.
+///
+/// The manifest, the shard headers and each row including its text carry a
+/// CRC-32C. Damaged entries and shards are skipped, the rest loads. If the
+/// manifest is damaged, the shards are recovered from the files.
+///
+/// Each shard ends with the trigram index of the full text of its entries,
+/// such that loading merges it instead of indexing the text. Being built
+/// from the full text it holds regardless of the spill threshold.
+///
+class Snapshot
+{
+public:
+
+    /// The shards written before, read before taking the view to write such
+    /// that it holds the entries of the months which changed only.
+    class Previous
+    {
+    public:
+
+        /// Returns true if the shard of _month_ is kept, i.e. its entries are
+        /// not needed for writing with _compression_age_.
+        bool keeps(const History::Month &month, qint64 compression_age) const;
+
+    private:
+
+        friend class Snapshot;
+        struct Data;
+        std::shared_ptr<const Data> d;
+
+    };
+
+    /// Reads the manifest at _path_, or recovers it from the shard files.
+    static Previous previous(const QString &path);
+
+    /// Writes the view _history_ to the manifest _path_ and shards next to it,
+    /// keeping the unchanged shards of _previous_, read from the same path.
+    /// _journal_ is the position of the journal matching the state of the view.
+    /// Does not need the history itself, i.e. runs off its lock. Stops early
+    /// if _cancel_ is set. Returns the size of all files or -1 on failure,
+    /// e.g. if the view misses the entries of a month to write.
+    static qint64 write(const QString &path, const Previous &previous,
+                        const History::View &history, Journal::Position journal,
+                        const std::atomic_bool *cancel = nullptr);
+
+    /// Opens the snapshot with the manifest at _path_. Recovers the shards from
+    /// the files next to it if the manifest could not be read. Returns null
+    /// if there are none. Shards are opened when they are reached.
+    static std::unique_ptr<Snapshot> open(const QString &path);
+
+    ~Snapshot();
+
+    /// Returns true if the manifest could not be read, i.e. the shards have
+    /// been recovered from the files and the whole journal applies.
+    bool isRecovered() const;
+
+    /// The size of all files in bytes.
+    qint64 fileSize() const;
+
+    /// The id following the ids of the entries in the snapshot.
+    quint64 nextId() const;
+
+    /// The position of the journal when the snapshot has been written.
+    Journal::Position journalPosition() const;
+
+    /// The number of shards read completely.
+    size_t shardsRead() const;
+
+    /// Returns true if all entries have been read.
+    bool atEnd() const;
+
+    /// The number of entries skipped so far because their checksums did not
+    /// match or their shard could not be read.
+    size_t damaged() const;
+
+    /// Reads up to _count_ entries of the current shard, most recent first,
+    /// and adds them to _history_ as the oldest entries. Skips entries with
+    /// _removed_ ids and shards that cannot be read.
+    void read(History &history, size_t count, const std::unordered_set<quint64> &removed);
+
+    /// Stops reading, e.g. before the end. Accounts the merged index postings
+    /// of the entries of the current shard not read as stale in _history_.
+    /// Reading must not continue afterwards.
+    void close(History &history);
+
+private:
+
+    Snapshot();
+    struct Private;
+    std::unique_ptr<Private> d;
+
+};
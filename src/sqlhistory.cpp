@@ -0,0 +1,197 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#if defined(CLIPBOARD_SQLITE)
+
+#include "history.h"
+#include "sqlhistory.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
+#include <atomic>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// fts5 trigram tokenizer, requires SQLite 3.34
+static const char *schema[] = {
+    "CREATE TABLE IF NOT EXISTS entries("
+    " id INTEGER PRIMARY KEY,"
+    " seq INTEGER NOT NULL,"
+    " datetime INTEGER NOT NULL,"
+    " hash INTEGER NOT NULL,"
+    " text TEXT NOT NULL)",
+    "CREATE INDEX IF NOT EXISTS entries_seq ON entries(seq)",
+    "CREATE INDEX IF NOT EXISTS entries_hash ON entries(hash)",
+    "CREATE VIRTUAL TABLE IF NOT EXISTS entries_fts USING fts5("
+    " text, content='entries', content_rowid='id', tokenize='trigram')",
+    "CREATE TRIGGER IF NOT EXISTS entries_ai AFTER INSERT ON entries BEGIN"
+    " INSERT INTO entries_fts(rowid, text) VALUES (new.id, new.text); END",
+    "CREATE TRIGGER IF NOT EXISTS entries_ad AFTER DELETE ON entries BEGIN"
+    " INSERT INTO entries_fts(entries_fts, rowid, text) VALUES ('delete', old.id, old.text); END",
+    // the row count, counted once for databases created without it
+    "CREATE TABLE IF NOT EXISTS entries_count(n INTEGER NOT NULL)",
+    "INSERT INTO entries_count SELECT COUNT(*) FROM entries"
+    " WHERE NOT EXISTS (SELECT 1 FROM entries_count)",
+    "CREATE TRIGGER IF NOT EXISTS entries_count_ai AFTER INSERT ON entries BEGIN"
+    " UPDATE entries_count SET n = n + 1; END",
+    "CREATE TRIGGER IF NOT EXISTS entries_count_ad AFTER DELETE ON entries BEGIN"
+    " UPDATE entries_count SET n = n - 1; END",
+};
+
+SqlHistory::SqlHistory(QString path) : path_(::move(path)) {}
+
+SqlHistory::~SqlHistory()
+{
+    for (const auto &name : connections_)
+        QSqlDatabase::removeDatabase(name);
+}
+
+QString SqlHistory::connection()
+{
+    // connections must not be shared across threads, thread ids get reused
+    static atomic_uint counter = 0;
+    thread_local const auto name = u"clipboard_%1"_s.arg(counter++);
+    if (!QSqlDatabase::contains(name))
+    {
+        // in memory, the connections share the database, it lives as long
+        // as any of them
+        auto db = QSqlDatabase::addDatabase(u"QSQLITE"_s, name);
+        if (path_.isEmpty())
+        {
+            db.setDatabaseName(u"file:clipboard?mode=memory&cache=shared"_s);
+            db.setConnectOptions(u"QSQLITE_OPEN_URI"_s);
+        }
+        else
+            db.setDatabaseName(path_);
+        if (db.open())
+            QSqlQuery(db).exec(u"PRAGMA busy_timeout = 1000"_s);
+
+        lock_guard lock(mutex_);
+        connections_.push_back(name);
+    }
+    return name;
+}
+
+bool SqlHistory::open()
+{
+    auto db = QSqlDatabase::database(connection());
+    if (!db.isOpen())
+        return false;
+
+    // readers do not block the writer
+    QSqlQuery q(db);
+    if (!q.exec(u"PRAGMA journal_mode = WAL"_s) || !q.exec(u"PRAGMA synchronous = NORMAL"_s))
+        return false;
+
+    for (const auto *statement : schema)
+        if (!q.exec(QString::fromLatin1(statement)))
+            return false;
+
+    return true;
+}
+
+quint64 SqlHistory::add(const QString &text, qint64 datetime)
+{
+    auto db = QSqlDatabase::database(connection());
+    const auto hash = (qint64)History::hash(text);
+    quint64 id = 0;
+
+    if (!db.transaction())
+        return 0;
+
+    QSqlQuery q(db);
+    q.prepare(u"SELECT id FROM entries WHERE hash = ? AND text = ?"_s);
+    q.addBindValue(hash);
+    q.addBindValue(text);
+
+    if (q.exec() && q.next())
+    {
+        id = q.value(0).toULongLong();
+        q.prepare(u"UPDATE entries SET seq = (SELECT MAX(seq) + 1 FROM entries), datetime = ?"
+                  " WHERE id = ?"_s);
+        q.addBindValue(datetime);
+        q.addBindValue(id);
+        if (!q.exec())
+            id = 0;
+    }
+    else
+    {
+        q.prepare(u"INSERT INTO entries(seq, datetime, hash, text)"
+                  " VALUES ((SELECT IFNULL(MAX(seq), 0) + 1 FROM entries), ?, ?, ?)"_s);
+        q.addBindValue(datetime);
+        q.addBindValue(hash);
+        q.addBindValue(text);
+        if (q.exec())
+            id = q.lastInsertId().toULongLong();
+    }
+
+    if (id == 0 || !db.commit())
+    {
+        db.rollback();
+        return 0;
+    }
+    return id;
+}
+
+bool SqlHistory::remove(quint64 id)
+{
+    QSqlQuery q(QSqlDatabase::database(connection()));
+    q.prepare(u"DELETE FROM entries WHERE id = ?"_s);
+    q.addBindValue(id);
+    return q.exec() && q.numRowsAffected() > 0;
+}
+
+bool SqlHistory::truncate(size_t limit)
+{
+    // by the maintained count, i.e. the offset walks the dropped rows only
+    QSqlQuery q(QSqlDatabase::database(connection()));
+    if (!q.exec(u"SELECT n FROM entries_count"_s) || !q.next())
+        return false;
+    if (const auto count = q.value(0).toLongLong(); count <= (qint64)limit)
+        return true;
+    else
+    {
+        q.prepare(u"DELETE FROM entries WHERE seq <= "
+                  "(SELECT seq FROM entries ORDER BY seq LIMIT 1 OFFSET ?)"_s);
+        q.addBindValue(count - (qint64)limit - 1);
+        return q.exec();
+    }
+}
+
+vector<SqlHistory::Row> SqlHistory::rows(const QString &query, size_t limit, size_t offset)
+{
+    QSqlQuery q(QSqlDatabase::database(connection()));
+    q.setForwardOnly(true);
+
+    if (query.isEmpty())
+        q.prepare(u"SELECT id, datetime, text FROM entries"
+                  " ORDER BY seq DESC LIMIT ? OFFSET ?"_s);
+
+    else if (query.size() >= 3)
+    {
+        // a quoted phrase matches substrings with the trigram tokenizer
+        q.prepare(u"SELECT e.id, e.datetime, e.text FROM entries_fts f"
+                  " JOIN entries e ON e.id = f.rowid WHERE entries_fts MATCH ?"
+                  " ORDER BY e.seq DESC LIMIT ? OFFSET ?"_s);
+        q.addBindValue(u"\"%1\""_s.arg(QString(query).replace(u'"', u"\"\""_s)));
+    }
+
+    else  // too short for trigrams, scans
+    {
+        q.prepare(u"SELECT id, datetime, text FROM entries WHERE text LIKE ? ESCAPE '\\'"
+                  " ORDER BY seq DESC LIMIT ? OFFSET ?"_s);
+        auto pattern = query;
+        pattern.replace(u'\\', u"\\\\"_s).replace(u'%', u"\\%"_s).replace(u'_', u"\\_"_s);
+        q.addBindValue(u"%"_s + pattern + u"%"_s);
+    }
+
+    q.addBindValue((qint64)limit);
+    q.addBindValue((qint64)offset);
+
+    vector<Row> rows;
+    if (q.exec())
+        while (q.next())
+            rows.push_back({q.value(0).toULongLong(), q.value(1).toLongLong(), q.value(2).toString()});
+    return rows;
+}
+
+#endif
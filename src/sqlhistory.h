@@ -0,0 +1,58 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <mutex>
+#include <vector>
+
+
+///
+/// SQLite backed history with an FTS5 trigram index.
+///
+/// An alternative to the in-memory History for very large histories. The
+/// entries live in the database only, i.e. memory stays flat, and queries of
+/// at least three characters use the full text index. Matches are substrings,
+/// case-insensitive. Thread-safe, each thread uses its own connection.
+///
+class SqlHistory
+{
+public:
+
+    struct Row
+    {
+        quint64 id;
+        qint64 datetime;
+        QString text;
+    };
+
+    /// Constructs a history stored at _path_, in memory if _path_ is empty.
+    explicit SqlHistory(QString path);
+    ~SqlHistory();
+
+    /// Opens or creates the database. Returns false if it cannot be opened or
+    /// SQLite lacks FTS5 or the trigram tokenizer.
+    bool open();
+
+    /// Adds _text_ as the most recent entry. Duplicates are moved to the front
+    /// and keep their id. Returns the id of the entry or 0 on failure.
+    quint64 add(const QString &text, qint64 datetime);
+
+    /// Removes the entry _id_. Returns false if there is no such entry.
+    bool remove(quint64 id);
+
+    /// Removes all but the _limit_ most recent entries.
+    bool truncate(size_t limit);
+
+    /// Returns up to _limit_ entries containing _query_, most recent first,
+    /// skipping the first _offset_ ones. An empty _query_ matches all entries.
+    std::vector<Row> rows(const QString &query, size_t limit, size_t offset);
+
+private:
+
+    QString connection();
+
+    const QString path_;
+    std::mutex mutex_;
+    std::vector<QString> connections_;
+
+};
@@ -0,0 +1,158 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "dictionary.h"
+#include "textarena.h"
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+// 512 KiB, large enough for malloc to map chunks separately and return
+// them to the system once a generation is dropped
+static constexpr quint32 chunk_capacity = 256 * 1024;
+
+TextArena::Ref TextArena::append(QStringView text, qint64 datetime)
+{
+    const auto length = (quint32)text.size();
+
+    // moved chunks may be frozen but have spare capacity
+    if (chunks_.empty() || !chunks_.back().buffer
+        || chunks_.back().capacity - chunks_.back().size < length)
+    {
+        const auto capacity = max(chunk_capacity, length);
+        auto buffer = make_shared_for_overwrite<char16_t[]>(capacity);
+        const auto *data = buffer.get();
+        chunks_.push_back({::move(buffer), {}, data, {}, {}, 0, capacity, 0,
+                           numeric_limits<qint64>::min()});
+    }
+
+    auto &chunk = chunks_.back();
+    copy_n(text.utf16(), length, chunk.buffer.get() + chunk.size);
+    Ref ref{(quint32)chunks_.size() - 1, chunk.size, length};
+    chunk.size += length;
+    chunk.newest = max(chunk.newest, datetime);
+    live_ += length;
+    return ref;
+}
+
+quint32 TextArena::addExternal(QStringView text, shared_ptr<const void> owner)
+{
+    // full, such that append never writes to it
+    const auto size = (quint32)text.size();
+    chunks_.push_back({nullptr, ::move(owner), text.utf16(), {}, {}, size, size, 0,
+                       numeric_limits<qint64>::min()});
+    return (quint32)chunks_.size() - 1;
+}
+
+quint32 TextArena::addCompressed(QByteArray compressed, quint32 size,
+                                 shared_ptr<const QByteArray> dictionary)
+{
+    chunks_.push_back({nullptr, {}, nullptr, ::move(compressed), ::move(dictionary), size, size,
+                       0, numeric_limits<qint64>::min()});
+    return (quint32)chunks_.size() - 1;
+}
+
+TextArena::Ref TextArena::reference(quint32 chunk, quint32 offset, quint32 length,
+                                    qint64 datetime)
+{
+    chunks_[chunk].newest = max(chunks_[chunk].newest, datetime);
+    live_ += length;
+    return {chunk, offset, length};
+}
+
+QStringView TextArena::view(Ref ref, Cache &cache) const
+{
+    const auto &chunk = chunks_[ref.chunk];
+    if (chunk.data)
+        return {chunk.data + ref.offset, (qsizetype)ref.length};
+
+    auto slot = (size_t)distance(cache.chunks_.begin(), ranges::find(cache.chunks_, ref.chunk));
+    if (slot == cache.chunks_.size())
+    {
+        slot = cache.next_++ % cache.chunks_.size();
+        cache.chunks_[slot] = ref.chunk;
+        if (!chunk.dictionary)
+            cache.data_[slot] = qUncompress(chunk.compressed);
+        else if (auto &data = cache.data_[slot] = QByteArray(chunk.size * (qsizetype)sizeof(char16_t),
+                                                             Qt::Uninitialized);
+                 !dictionaryDecompress(chunk.compressed, *chunk.dictionary, data.data(), data.size()))
+            data.fill(0);  // verified when read, should not happen
+    }
+
+    return {reinterpret_cast<const char16_t*>(cache.data_[slot].constData()) + ref.offset,
+            (qsizetype)ref.length};
+}
+
+void TextArena::release(Ref ref)
+{
+    // external and compressed text is not on the heap or shrunk already,
+    // compacting it would copy it to the heap
+    auto &chunk = chunks_[ref.chunk];
+    chunk.released += ref.length;
+    live_ -= ref.length;
+    if (chunk.buffer)
+        dead_ += ref.length;
+}
+
+TextArena::Ref TextArena::move(const TextArena &other, Ref ref, qint64 datetime, Moved &moved)
+{
+    const auto &chunk = other.chunks_[ref.chunk];
+    if (chunk.buffer && chunk.released > chunk.size / 2)
+        return append({chunk.data + ref.offset, (qsizetype)ref.length}, datetime);
+
+    // shared chunks are released but the text referenced again
+    auto [it, added] = moved.try_emplace(ref.chunk, (quint32)chunks_.size());
+    if (added)
+    {
+        auto &copy = chunks_.emplace_back(chunk);
+        copy.released = copy.size;
+        copy.newest = numeric_limits<qint64>::min();
+        if (copy.buffer)
+            dead_ += copy.size;
+    }
+
+    auto &copy = chunks_[it->second];
+    copy.released -= ref.length;
+    if (copy.buffer)
+        dead_ -= ref.length;
+    return reference(it->second, ref.offset, ref.length, datetime);
+}
+
+vector<TextArena::Frozen> TextArena::freezable(qint64 datetime) const
+{
+    // never the chunk appended to
+    vector<Frozen> chunks;
+    for (size_t i = 0; i + 1 < chunks_.size(); ++i)
+        if (const auto &chunk = chunks_[i]; chunk.buffer && chunk.newest < datetime)
+            chunks.push_back({chunk.buffer, chunk.size, {}});
+    return chunks;
+}
+
+void TextArena::compress(vector<Frozen> &chunks)
+{
+    for (auto &chunk : chunks)
+        chunk.compressed = qCompress(reinterpret_cast<const uchar*>(chunk.buffer.get()),
+                                     chunk.size * (qsizetype)sizeof(char16_t));
+}
+
+void TextArena::freeze(const vector<Frozen> &chunks)
+{
+    // compactions renumber the chunks, moved ones keep their buffer
+    unordered_map<const char16_t*, const Frozen*> frozen;
+    for (const auto &chunk : chunks)
+        frozen.emplace(chunk.buffer.get(), &chunk);
+
+    for (auto &chunk : chunks_)
+        if (auto it = frozen.find(chunk.buffer.get());
+            chunk.buffer && it != frozen.end() && it->second->size == chunk.size
+            && !it->second->compressed.isNull())
+        {
+            chunk.compressed = it->second->compressed;
+            chunk.buffer.reset();
+            chunk.data = nullptr;
+            dead_ -= chunk.released;
+        }
+}
+
+size_t TextArena::liveSize() const { return live_; }
+
+size_t TextArena::deadSize() const { return dead_; }
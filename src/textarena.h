@@ -0,0 +1,143 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QStringView>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+///
+/// Append-only storage for UTF-16 text.
+///
+/// Text is copied into large chunks instead of one heap allocation per
+/// string. Releasing text only updates the accounting, the memory is
+/// reclaimed by moving the live text into a new generation, see
+/// History::compact. Only text copied into the arena counts as dead once
+/// released. Chunks are moved as a whole unless most of their text is dead,
+/// i.e. stay shared as long as any of their text is referenced.
+///
+/// Chunks holding old text only can be frozen, i.e. compressed as a whole,
+/// off the lock of the owner. Readers decompress frozen chunks on demand into
+/// a Cache of their own.
+/// External chunks are never frozen, they are backed by files already.
+/// Chunks read compressed from files are frozen from the start.
+///
+/// Copies share the text, i.e. are cheap and stay valid for readers of the
+/// text referenced so far while the original is appended to, frozen or
+/// dropped.
+///
+/// Not thread-safe, except for concurrent readers.
+///
+class TextArena
+{
+public:
+
+    struct Ref
+    {
+        quint32 chunk;
+        quint32 offset;
+        quint32 length;  // in UTF-16 code units, zero for released text
+    };
+
+    ///
+    /// Decompressed frozen chunks of a reader.
+    ///
+    /// Holds the last few chunks such that scans in append order decompress
+    /// each chunk once.
+    ///
+    class Cache
+    {
+        friend class TextArena;
+        std::array<quint32, 4> chunks_{~0u, ~0u, ~0u, ~0u};
+        std::array<QByteArray, 4> data_;
+        size_t next_ = 0;
+    };
+
+    /// Copies _text_ with timestamp _datetime_ into the arena.
+    Ref append(QStringView text, qint64 datetime);
+
+    /// Adds a read-only chunk using external _text_ in place, e.g. a mapped
+    /// file. _owner_ keeps the text alive. Returns the index of the chunk.
+    quint32 addExternal(QStringView text, std::shared_ptr<const void> owner);
+
+    /// Adds a frozen chunk of _size_ code units, _compressed_ to a raw deflate
+    /// stream using the preset _dictionary_, e.g. read from a file. Returns the
+    /// index of the chunk.
+    quint32 addCompressed(QByteArray compressed, quint32 size,
+                          std::shared_ptr<const QByteArray> dictionary);
+
+    /// References text with timestamp _datetime_ in a chunk added by
+    /// addExternal or addCompressed.
+    Ref reference(quint32 chunk, quint32 offset, quint32 length, qint64 datetime);
+
+    /// Returns a view of the text referenced by _ref_.
+    /// The view is valid until the arena is destroyed or, if the text lives
+    /// in a frozen chunk, until _cache_ decompressed four more chunks.
+    QStringView view(Ref ref, Cache &cache) const;
+
+    /// Marks the text referenced by _ref_ as unused.
+    void release(Ref ref);
+
+    /// The chunks of another arena moved as a whole, see move.
+    using Moved = std::unordered_map<quint32, quint32>;
+
+    /// Moves the text referenced by _ref_ in _other_ with timestamp _datetime_
+    /// into this arena. Copies the text of mostly released uncompressed
+    /// chunks, shares all other chunks without touching their text, such that
+    /// only what is worth reclaiming is copied. Pass the same _moved_ for all
+    /// text moved from _other_. Returns the new reference.
+    Ref move(const TextArena &other, Ref ref, qint64 datetime, Moved &moved);
+
+    ///
+    /// A chunk compressed off the lock, see freezable.
+    ///
+    struct Frozen
+    {
+        std::shared_ptr<const char16_t[]> buffer;  // identifies the chunk
+        quint32 size;
+        QByteArray compressed;
+    };
+
+    /// Returns the uncompressed chunks holding text older than _datetime_
+    /// only, never the one appended to. Compress them using compress, e.g.
+    /// off the lock, then replace them using freeze.
+    std::vector<Frozen> freezable(qint64 datetime) const;
+
+    /// Compresses the text of _chunks_. Does not touch any arena, i.e. is
+    /// thread-safe.
+    static void compress(std::vector<Frozen> &chunks);
+
+    /// Replaces the text of _chunks_ by the compressed text, unless a chunk
+    /// changed or was dropped meanwhile.
+    void freeze(const std::vector<Frozen> &chunks);
+
+    /// The number of code units in use.
+    size_t liveSize() const;
+
+    /// The number of code units copied into the arena, released but not yet
+    /// reclaimed.
+    size_t deadSize() const;
+
+private:
+
+    struct Chunk
+    {
+        std::shared_ptr<char16_t[]> buffer;  // null if external or frozen, shared by copies
+        std::shared_ptr<const void> owner;  // of external text
+        const char16_t *data;  // null if frozen
+        QByteArray compressed;
+        std::shared_ptr<const QByteArray> dictionary;  // of compressed, qCompress format if null
+        quint32 size;
+        quint32 capacity;
+        quint32 released;  // code units
+        qint64 newest;  // the most recent timestamp of the text in this chunk
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t live_ = 0;
+    size_t dead_ = 0;
+
+};
@@ -0,0 +1,98 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "tombstones.h"
+#include <algorithm>
+using namespace std;
+
+static constexpr qint64 min_slack = 1024;
+
+void Tombstones::insert(qint64 seq)
+{
+    if (seq < base_ || seq - base_ >= (qint64)marks_.size())
+        rebuild(seq);
+
+    const auto index = (size_t)(seq - base_);
+    if (!marks_[index])
+    {
+        marks_[index] = true;
+        add(index, 1);
+        ++size_;
+    }
+}
+
+void Tombstones::erase(qint64 seq)
+{
+    if (seq < base_ || seq - base_ >= (qint64)marks_.size())
+        return;
+
+    const auto index = (size_t)(seq - base_);
+    if (marks_[index])
+    {
+        marks_[index] = false;
+        add(index, -1);
+        --size_;
+    }
+}
+
+void Tombstones::clear()
+{
+    marks_.clear();
+    tree_.clear();
+    size_ = 0;
+}
+
+size_t Tombstones::size() const { return size_; }
+
+size_t Tombstones::countAbove(qint64 seq) const
+{
+    if (seq < base_)
+        return size_;
+    else if (seq - base_ >= (qint64)marks_.size())
+        return 0;
+
+    // minus the prefix up to and including seq
+    size_t prefix = 0;
+    for (auto i = (size_t)(seq - base_) + 1; i > 0; i -= i & -i)
+        prefix += tree_[i - 1];
+    return size_ - prefix;
+}
+
+void Tombstones::add(size_t index, qint32 delta)
+{
+    for (auto i = index + 1; i <= tree_.size(); i += i & -i)
+        tree_[i - 1] += (quint32)delta;
+}
+
+void Tombstones::rebuild(qint64 seq)
+{
+    // the range of the marks and seq, the slack grows with it towards seq
+    auto first = seq, last = seq;
+    for (size_t i = 0; i < marks_.size(); ++i)
+        if (marks_[i])
+        {
+            first = min(first, base_ + (qint64)i);
+            last = max(last, base_ + (qint64)i);
+        }
+
+    const auto slack = max(last - first + 1, min_slack);
+    const auto base = seq == first ? first - slack : first;
+    const auto end = seq == last ? last + slack + 1 : last + 1;
+
+    vector<bool> marks((size_t)(end - base), false);
+    for (size_t i = 0; i < marks_.size(); ++i)
+        if (marks_[i])
+            marks[(size_t)(base_ + (qint64)i - base)] = true;
+
+    // linear construction, each node passes its count to its parent
+    vector<quint32> tree(marks.size());
+    for (size_t i = 1; i <= tree.size(); ++i)
+    {
+        tree[i - 1] += marks[i - 1];
+        if (const auto parent = i + (i & -i); parent <= tree.size())
+            tree[parent - 1] += tree[i - 1];
+    }
+
+    base_ = base;
+    marks_ = ::move(marks);
+    tree_ = ::move(tree);
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QtGlobal>
+#include <vector>
+
+
+///
+/// Set of the sequence numbers of removed history entries.
+///
+/// Counts the tombstones in O(1) and the ones following a sequence number in
+/// O(log n) using a Fenwick tree, such that ranks among the live entries are
+/// cheap. The tree covers the range of the tombstones plus slack on either
+/// side and is rebuilt in O(n) once a sequence number falls outside, i.e.
+/// amortized O(log n) per modification.
+///
+/// Not thread-safe, except for concurrent readers.
+///
+class Tombstones
+{
+public:
+
+    /// Adds _seq_.
+    void insert(qint64 seq);
+
+    /// Removes _seq_ if it is contained.
+    void erase(qint64 seq);
+
+    /// Removes all.
+    void clear();
+
+    /// The number of tombstones.
+    size_t size() const;
+
+    /// The number of tombstones greater than _seq_.
+    size_t countAbove(qint64 seq) const;
+
+private:
+
+    void add(size_t index, qint32 delta);
+    void rebuild(qint64 seq);
+
+    qint64 base_ = 0;  // sequence number of index 0
+    std::vector<bool> marks_;
+    std::vector<quint32> tree_;  // tree_[i] counts the marks in (i + 1 - lowbit(i + 1), i]
+    size_t size_ = 0;
+
+};
@@ -0,0 +1,139 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "trigramindex.h"
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+namespace {
+
+// without diacritics and case folded, zero for combining marks
+char32_t normalize(char32_t c)
+{
+    if (c < 0x80)
+        return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+
+    while (QChar::decompositionTag(c) == QChar::Canonical)
+    {
+        const auto d = QChar::decomposition(c);
+        c = d[0].isHighSurrogate() ? QChar::surrogateToUcs4(d[0], d[1]) : d[0].unicode();
+    }
+
+    if (const auto category = QChar::category(c);
+        category == QChar::Mark_NonSpacing
+        || category == QChar::Mark_SpacingCombining
+        || category == QChar::Mark_Enclosing)
+        return 0;
+
+    return QChar::toCaseFolded(QChar::toLower(c));
+}
+
+// calls f with the trigrams of the words of text, 21 bits per code point
+template<class F>
+void forEachTrigram(QStringView text, F &&f)
+{
+    constexpr quint64 mask = (quint64(1) << 63) - 1;
+    quint64 key = 0;
+    int run = 0;
+    for (qsizetype i = 0; i < text.size(); ++i)
+    {
+        char32_t c = text[i].unicode();
+        if (text[i].isHighSurrogate() && i + 1 < text.size() && text[i + 1].isLowSurrogate())
+        {
+            c = QChar::surrogateToUcs4(text[i], text[i + 1]);
+            ++i;
+        }
+
+        if (c = normalize(c); c == 0)
+            continue;  // marks do not split words
+        else if (!QChar::isLetterOrNumber(c))
+            run = 0;
+        else if (key = (key << 21 | c) & mask; ++run >= 3)
+            f(key);
+    }
+}
+
+}
+
+void TrigramIndex::add(quint64 id, QStringView text)
+{
+    if (id > numeric_limits<quint32>::max())
+    {
+        usable_ = false;
+        return;
+    }
+
+    scratch_.clear();
+    forEachTrigram(text, [this](quint64 key) { scratch_.push_back(key); });
+    ranges::sort(scratch_);
+    scratch_.erase(ranges::unique(scratch_).begin(), scratch_.end());
+
+    for (const auto key : scratch_)
+        postings_[key].push_back((quint32)id);
+
+    live_ += (quint64)max<qsizetype>(text.size() - 2, 0);
+}
+
+void TrigramIndex::addPostings(quint64 key, span<const quint64> ids)
+{
+    if (ranges::any_of(ids, [](quint64 id){ return id > numeric_limits<quint32>::max(); }))
+    {
+        usable_ = false;
+        return;
+    }
+
+    auto &postings = postings_[key];
+    postings.insert(postings.end(), ids.begin(), ids.end());
+    live_ += ids.size();
+}
+
+void TrigramIndex::remove(qsizetype length)
+{
+    const auto postings = (quint64)max<qsizetype>(length - 2, 0);
+    live_ -= min(live_, postings);
+    stale_ += postings;
+}
+
+void TrigramIndex::discard(quint64 count)
+{
+    live_ -= min(live_, count);
+    stale_ += count;
+}
+
+void TrigramIndex::clear()
+{
+    postings_.clear();
+    live_ = 0;
+    stale_ = 0;
+    usable_ = true;
+}
+
+size_t TrigramIndex::memoryUsage() const { return (size_t)live_ * sizeof(quint32); }
+
+size_t TrigramIndex::memoryUsage(qsizetype length)
+{ return (size_t)max<qsizetype>(length - 2, 0) * sizeof(quint32); }
+
+bool TrigramIndex::needsRebuild() const { return stale_ > live_ && stale_ > 1024 * 1024; }
+
+optional<span<const quint32>> TrigramIndex::find(QStringView query) const
+{
+    if (!usable_)
+        return nullopt;
+
+    const vector<quint32> *rarest = nullptr;
+    bool found = true;
+    forEachTrigram(query, [&](quint64 key)
+    {
+        if (auto it = postings_.find(key); it == postings_.end())
+            found = false;
+        else if (!rarest || it->second.size() < rarest->size())
+            rarest = &it->second;
+    });
+
+    if (!found)
+        return span<const quint32>();
+    else if (rarest)
+        return span<const quint32>(*rarest);
+    else
+        return nullopt;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+
+///
+/// Trigram inverted index over the history text.
+///
+/// Maps the trigrams of the words of the normalized text, i.e. case folded
+/// and without diacritics, to the ids of the entries containing them. The
+/// entries of the rarest trigram of a query are a superset of its matches,
+/// the caller verifies them. Normalizing and splitting words is coarser than
+/// the matcher, such that no match is missed.
+///
+/// Removing entries leaves stale postings, which the caller filters. They are
+/// estimated by the text length, once they outweigh the live ones the index
+/// should be rebuilt. Ids take 32 bits, the index is unusable if an id
+/// exceeds them. Persisted indexes, e.g. of snapshot shards, are built using
+/// the same class and merged by their postings.
+///
+/// Not thread-safe.
+///
+class TrigramIndex
+{
+public:
+
+    /// Adds the trigrams of _text_ of the entry with _id_.
+    void add(quint64 id, QStringView text);
+
+    /// Adds the postings _ids_ of the trigram _key_, e.g. of a persisted index.
+    void addPostings(quint64 key, std::span<const quint64> ids);
+
+    /// Accounts the postings of a removed entry with text of _length_ as stale.
+    void remove(qsizetype length);
+
+    /// Accounts _count_ postings added by addPostings as stale, e.g. of
+    /// entries never added.
+    void discard(quint64 count);
+
+    /// Removes all postings.
+    void clear();
+
+    /// The estimated bytes of memory used by the live postings.
+    size_t memoryUsage() const;
+
+    /// The estimated bytes of memory used by the postings of text of _length_.
+    static size_t memoryUsage(qsizetype length);
+
+    /// Returns true if the stale postings outweigh the live ones.
+    bool needsRebuild() const;
+
+    /// Returns the ids of the rarest trigram of the words of _query_, in no
+    /// particular order, including stale ones and duplicates. Returns null if
+    /// the words of _query_ are shorter than three characters or the index is
+    /// unusable, then any entry is a candidate.
+    std::optional<std::span<const quint32>> find(QStringView query) const;
+
+    /// Calls _f_ with the key and the postings of each trigram, in no
+    /// particular order.
+    template<class F>
+    void forEach(F &&f) const
+    {
+        for (const auto &[key, ids] : postings_)
+            f(key, std::span<const quint32>(ids));
+    }
+
+private:
+
+    std::unordered_map<quint64, std::vector<quint32>> postings_;
+    std::vector<quint64> scratch_;
+    quint64 live_ = 0;  // estimated
+    quint64 stale_ = 0;  // estimated
+    bool usable_ = true;
+
+};